@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "solution.hpp"
+
+// Load generator for evaluate(). Usage:
+//
+//   load [--threads=N] [--seconds=S] [--rate=R] [--invalid=F] [--long=F] [--long-terms=T]
+//
+// Every thread picks expressions at random: the --invalid fraction of them are malformed and
+// the --long fraction have T terms instead of a handful. With --rate=0 (the default) threads
+// run closed loop; otherwise each thread issues R calls per second on a fixed schedule and
+// latency is measured from the scheduled start, so a stalled call also counts against the
+// calls queued behind it.
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    // Log-linear histogram in the style of HdrHistogram: values below 128 ns get their own
+    // bucket, larger ones are split into 64 buckets per power of two (under 1.6% error).
+    class LatencyHistogram
+    {
+    public:
+        auto record(std::uint64_t ns) -> void
+        {
+            m_counts[bucket(ns)]++;
+            m_total++;
+            m_max = std::max(m_max, ns);
+        }
+
+        auto merge(LatencyHistogram const& other) -> void
+        {
+            for (std::size_t i = 0; i < m_counts.size(); i++)
+            {
+                m_counts[i] += other.m_counts[i];
+            }
+
+            m_total += other.m_total;
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        // Upper bound of the bucket holding the value at `percentile` (0 to 100).
+        [[nodiscard]] auto percentile(double percentile) const -> std::uint64_t
+        {
+            auto rank = std::uint64_t(percentile / 100 * double(m_total));
+            rank = std::clamp<std::uint64_t>(rank, 1, m_total);
+
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < m_counts.size(); i++)
+            {
+                seen += m_counts[i];
+                if (seen >= rank)
+                {
+                    return std::min(upper_bound(i), m_max);
+                }
+            }
+
+            return m_max;
+        }
+
+        [[nodiscard]] auto total() const -> std::uint64_t
+        {
+            return m_total;
+        }
+
+        [[nodiscard]] auto max() const -> std::uint64_t
+        {
+            return m_max;
+        }
+
+    private:
+        static constexpr unsigned sub_bits = 7;
+        static constexpr std::size_t linear = std::size_t{1} << sub_bits;
+        static constexpr std::size_t half = linear / 2;
+
+        static auto bucket(std::uint64_t v) -> std::size_t
+        {
+            if (v < linear)
+            {
+                return std::size_t(v);
+            }
+
+            auto shift = unsigned(63 - __builtin_clzll(v)) - (sub_bits - 1);
+
+            return linear + (shift - 1) * half + std::size_t((v >> shift) - half);
+        }
+
+        static auto upper_bound(std::size_t i) -> std::uint64_t
+        {
+            if (i < linear)
+            {
+                return i;
+            }
+
+            auto shift = unsigned((i - linear) / half + 1);
+            std::uint64_t mantissa = (i - linear) % half + half;
+
+            return ((mantissa + 1) << shift) - 1;
+        }
+
+        std::array<std::uint64_t, linear + 64 * half> m_counts{};
+        std::uint64_t m_total = 0;
+        std::uint64_t m_max = 0;
+    };
+
+    struct Options
+    {
+        unsigned threads = 4;
+        double seconds = 5;
+        double rate = 0;
+        double invalid = 0.1;
+        double long_fraction = 0.05;
+        std::size_t long_terms = 10000;
+    };
+
+    auto parse_options(int argc, char** argv) -> Options
+    {
+        Options options;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            std::string key = arg.substr(0, eq);
+            char const* value = eq == std::string::npos ? "" : argv[i] + eq + 1;
+
+            if (key == "--threads")
+            {
+                options.threads = unsigned(std::max(1L, std::strtol(value, nullptr, 10)));
+            }
+            else if (key == "--seconds")
+            {
+                options.seconds = std::strtod(value, nullptr);
+            }
+            else if (key == "--rate")
+            {
+                options.rate = std::strtod(value, nullptr);
+            }
+            else if (key == "--invalid")
+            {
+                options.invalid = std::strtod(value, nullptr);
+            }
+            else if (key == "--long")
+            {
+                options.long_fraction = std::strtod(value, nullptr);
+            }
+            else if (key == "--long-terms")
+            {
+                options.long_terms = std::size_t(std::strtoull(value, nullptr, 10));
+            }
+            else
+            {
+                std::cerr << "unknown option " << arg << "\n";
+                std::exit(2);
+            }
+        }
+
+        return options;
+    }
+
+    auto make_expression(std::mt19937_64& rng, std::size_t terms, bool valid) -> std::string
+    {
+        static char const ops[] = "+-*/";
+
+        std::string ret = std::to_string(rng() % 100 + 1);
+        for (std::size_t i = 1; i < terms; i++)
+        {
+            std::string operand = std::to_string(rng() % 100 + 1);
+
+            ret += ' ';
+            ret += ops[rng() % 4];
+            ret += rng() % 4 == 0 ? " (" + operand + " - 0.5)" : " " + operand;
+        }
+
+        if (!valid)
+        {
+            ret += rng() % 2 == 0 ? " +" : " * (1";
+        }
+
+        return ret;
+    }
+
+    // Expressions indexed by [long][invalid].
+    using Pool = std::array<std::array<std::vector<std::string>, 2>, 2>;
+
+    auto make_pool(Options const& options) -> Pool
+    {
+        std::mt19937_64 rng(42);
+        Pool pool;
+
+        for (int is_long = 0; is_long < 2; is_long++)
+        {
+            for (int invalid = 0; invalid < 2; invalid++)
+            {
+                for (int i = 0; i < 64; i++)
+                {
+                    std::size_t terms = is_long != 0 ? options.long_terms : rng() % 8 + 2;
+                    pool[is_long][invalid].push_back(
+                        make_expression(rng, terms, invalid == 0));
+                }
+            }
+        }
+
+        return pool;
+    }
+
+    // Adds the results to `sink`, so the evaluations cannot be optimized away.
+    auto run_thread(Options const& options, Pool const& pool, unsigned seed,
+        clock_type::time_point start, LatencyHistogram& histogram, double& sink) -> void
+    {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> unit(0, 1);
+
+        auto end = start + std::chrono::duration<double>(options.seconds);
+        auto interval = std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(options.rate > 0 ? 1 / options.rate : 0));
+        auto scheduled = start;
+
+        double sum = 0;
+        while (true)
+        {
+            if (options.rate > 0)
+            {
+                std::this_thread::sleep_until(scheduled);
+            }
+            else
+            {
+                scheduled = clock_type::now();
+            }
+
+            if (scheduled >= end)
+            {
+                break;
+            }
+
+            bool is_long = unit(rng) < options.long_fraction;
+            bool invalid = unit(rng) < options.invalid;
+            auto const& candidates = pool[is_long ? 1 : 0][invalid ? 1 : 0];
+
+            sum += evaluate(candidates[rng() % candidates.size()]).result;
+
+            auto latency = clock_type::now() - scheduled;
+            histogram.record(std::uint64_t(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count()));
+
+            scheduled += interval;
+        }
+
+        sink = sum;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options = parse_options(argc, argv);
+    Pool pool = make_pool(options);
+
+    std::vector<LatencyHistogram> histograms(options.threads);
+    std::vector<double> sinks(options.threads);
+    std::vector<std::thread> threads;
+
+    auto start = clock_type::now() + std::chrono::milliseconds(10);
+    for (unsigned t = 0; t < options.threads; t++)
+    {
+        threads.emplace_back(
+            run_thread, std::cref(options), std::cref(pool), t + 1, start,
+            std::ref(histograms[t]), std::ref(sinks[t]));
+    }
+
+    LatencyHistogram total;
+    double sink = 0;
+    for (unsigned t = 0; t < options.threads; t++)
+    {
+        threads[t].join();
+        total.merge(histograms[t]);
+        sink += sinks[t];
+    }
+
+    auto us = [](std::uint64_t ns) { return double(ns) / 1000; };
+
+    std::cout << std::fixed << std::setprecision(1) << "threads " << options.threads << ", ";
+    if (options.rate > 0)
+    {
+        std::cout << options.rate << " calls/s per thread, ";
+    }
+    else
+    {
+        std::cout << "closed loop, ";
+    }
+
+    std::cout << total.total() << " calls, "
+              << double(total.total()) / options.seconds << " calls/s\n"
+              << "p50   " << us(total.percentile(50)) << " us\n"
+              << "p99   " << us(total.percentile(99)) << " us\n"
+              << "p99.9 " << us(total.percentile(99.9)) << " us\n"
+              << "max   " << us(total.max()) << " us\n";
+
+    // Keeps the evaluations from being optimized away.
+    return sink == 0.125 ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "policy.hpp"
+#include "solution.hpp"
+
+namespace
+{
+    auto make_expression(std::size_t terms) -> std::string
+    {
+        std::string ret = "1";
+        for (std::size_t i = 1; i < terms; i++)
+        {
+            static char const ops[] = "+-*/";
+            std::string operand = std::to_string(i % 97 + 1);
+
+            ret += ' ';
+            ret += ops[i % 4];
+            ret += i % 5 == 0 ? " (" + operand + " + 0.5)" : " " + operand;
+        }
+
+        return ret;
+    }
+
+    template<typename policy>
+    auto run(char const* name, std::vector<std::string> const& inputs, std::size_t rounds)
+        -> double
+    {
+        double sink = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            for (auto const& input : inputs)
+            {
+                sink += evaluate_with<policy>(input).result;
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count()
+                  / double(rounds * inputs.size());
+        std::cout << "  " << std::left << std::setw(14) << name << std::right << std::setw(12)
+                  << std::fixed << std::setprecision(1) << ns << " ns/expr\n";
+
+        return sink;
+    }
+}
+
+int main()
+{
+    struct Case
+    {
+        std::size_t terms;
+        std::size_t count;
+        std::size_t rounds;
+    };
+
+    double sink = 0;
+    for (auto [terms, count, rounds] : {Case{4, 1000, 200}, Case{64, 100, 100},
+                                        Case{4096, 4, 50}, Case{1 << 18, 1, 3}})
+    {
+        std::vector<std::string> inputs(count, make_expression(terms));
+        std::cout << terms << " terms:\n";
+
+        sink += run<circular_policy>("circular", inputs, rounds);
+        sink += run<small_vector_policy>("small_vector", inputs, rounds);
+        sink += run<ring_buffer_policy>("ring_buffer", inputs, rounds);
+        sink += run<compact_policy>("compact", inputs, rounds);
+    }
+
+    // Keeps the evaluations from being optimized away.
+    return sink == 0.125 ? 1 : 0;
+}
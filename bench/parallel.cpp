@@ -0,0 +1,96 @@
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parallel.hpp"
+#include "solution.hpp"
+
+namespace
+{
+    // A balanced tree of parenthesized groups, the shape evaluate_parallel splits well.
+    auto make_balanced(std::size_t bytes) -> std::string
+    {
+        std::string ret = "0.1";
+        for (std::size_t i = 0; ret.size() < bytes; i++)
+        {
+            ret = "(" + ret + (i % 2 == 0 ? " / 3 + " : " - 7 * ") + ret + ")";
+        }
+
+        return ret;
+    }
+
+    // One long left-to-right chain: only the scan is split, conversion and reduction are not.
+    auto make_flat(std::size_t bytes) -> std::string
+    {
+        static char const ops[] = "+-*/";
+
+        std::string ret = "1";
+        for (std::size_t i = 1; ret.size() < bytes; i++)
+        {
+            ret += ' ';
+            ret += ops[i % 4];
+            ret += ' ';
+            ret += std::to_string(i % 97 + 1);
+        }
+
+        return ret;
+    }
+
+    template<typename evaluator>
+    auto run(std::string const& name, std::size_t rounds, evaluator eval) -> double
+    {
+        double sink = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            sink += eval().result;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double ms = std::chrono::duration<double, std::milli>(elapsed).count() / double(rounds);
+        std::cout << "  " << std::left << std::setw(30) << name << std::right << std::setw(10)
+                  << std::fixed << std::setprecision(1) << ms << " ms\n";
+
+        return sink;
+    }
+}
+
+int main()
+{
+    constexpr std::size_t size = std::size_t{16} << 20;
+    constexpr std::size_t rounds = 3;
+
+    std::vector<unsigned> thread_counts{1};
+    for (unsigned t = 2; t < std::thread::hardware_concurrency(); t *= 2)
+    {
+        thread_counts.push_back(t);
+    }
+    if (std::thread::hardware_concurrency() > 1)
+    {
+        thread_counts.push_back(std::thread::hardware_concurrency());
+    }
+
+    double sink = 0;
+    for (auto const& [name, input] : {std::pair{"balanced", make_balanced(size)},
+                                      std::pair{"flat", make_flat(size)}})
+    {
+        std::cout << name << " (" << input.size() / (1 << 20) << " MB):\n";
+
+        sink += run("evaluate()", rounds, [&input] { return evaluate(input); });
+        for (unsigned threads : thread_counts)
+        {
+            sink += run("evaluate_parallel(" + std::to_string(threads) + " threads)", rounds,
+                [&input, threads] {
+                    return evaluate_parallel(input, default_parallel_threshold, threads);
+                });
+        }
+    }
+
+    // Keeps the evaluations from being optimized away.
+    return sink == 0 ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scanner.hpp"
+#include "solution.hpp"
+#include "token.hpp"
+
+namespace
+{
+    // Operator dense: mostly one and two digit integers, some decimals and parentheses.
+    auto make_dense(std::size_t bytes) -> std::string
+    {
+        static char const ops[] = "+-*/";
+
+        std::string ret;
+        ret.reserve(bytes + 32);
+        for (std::size_t i = 0; ret.size() < bytes; i++)
+        {
+            ret += std::to_string(i % 97);
+            if (i % 7 == 0)
+            {
+                ret += '.';
+                ret += char('0' + i % 10);
+            }
+
+            ret += ops[i % 4];
+            if (i % 11 == 0)
+            {
+                ret += "(1)+";
+            }
+        }
+        ret += '1';
+
+        return ret;
+    }
+
+    // Whitespace separated, with longer decimals and exponents.
+    auto make_spaced(std::size_t bytes) -> std::string
+    {
+        std::string ret;
+        ret.reserve(bytes + 32);
+        for (std::size_t i = 0; ret.size() < bytes; i++)
+        {
+            ret += std::to_string(i * 7919 % 100000);
+            ret += i % 3 == 0 ? ".125" : "";
+            ret += i % 13 == 0 ? "e-3" : "";
+            ret += i % 2 == 0 ? "  +  " : " *\n";
+        }
+        ret += '1';
+
+        return ret;
+    }
+
+    template<typename container>
+    auto run(char const* name, std::string const& input, std::size_t rounds) -> std::size_t
+    {
+        // A first, untimed, scan sizes the container, so the rounds measure scanning only.
+        container out;
+        scan_tokens(input, out);
+        std::size_t tokens = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            out.clear();
+            scan_tokens(input, out);
+            tokens += out.size();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double mb_per_s = double(input.size() * rounds) / seconds / 1e6;
+        std::cout << "  " << std::left << std::setw(22) << name << std::right << std::setw(10)
+                  << std::fixed << std::setprecision(0) << mb_per_s << " MB/s\n";
+
+        return tokens;
+    }
+
+    auto run_tokenize(std::string const& input, std::size_t rounds) -> std::size_t
+    {
+        std::size_t tokens = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t r = 0; r < rounds; r++)
+        {
+            tokens += tokenize(input).size();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        double mb_per_s = double(input.size() * rounds) / seconds / 1e6;
+        std::cout << "  " << std::left << std::setw(22) << "tokenize()" << std::right
+                  << std::setw(10) << std::fixed << std::setprecision(0) << mb_per_s
+                  << " MB/s\n";
+
+        return tokens;
+    }
+}
+
+int main()
+{
+    constexpr std::size_t size = std::size_t{64} << 20;
+    constexpr std::size_t rounds = 5;
+
+    std::size_t tokens = 0;
+    for (auto const& [name, input] : {std::pair{"dense", make_dense(size)},
+                                      std::pair{"spaced", make_spaced(size)}})
+    {
+        std::cout << name << " (" << input.size() / (1 << 20) << " MB):\n";
+
+        tokens += run<std::vector<Token>>("vector<Token>", input, rounds);
+        tokens += run<std::vector<symbol>>("vector<symbol>", input, rounds);
+        tokens += run_tokenize(input, 1);
+    }
+
+    // Keeps the scans from being optimized away.
+    return tokens == 0 ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "solution.hpp"
+
+// Cost limits for untrusted expressions. Every limit defaults to unlimited.
+struct Limits
+{
+    static constexpr std::size_t unlimited = std::numeric_limits<std::size_t>::max();
+
+    std::size_t max_input_length = unlimited;
+    std::size_t max_tokens = unlimited;
+    std::size_t max_nesting = unlimited;
+    std::size_t max_operations = unlimited;
+};
+
+// Checks `input` against `limits` without allocating, by running the tokenizer into a counter
+// that stops at the first count over its limit. An input that passes produces no more
+// tokens, parentheses nesting or operators than allowed.
+auto within_limits(std::string_view input, Limits const& limits) -> bool;
+
+// Like evaluate(input), but inputs over `limits` are rejected before they are tokenized, with
+// an ErrorKind::limit error.
+auto evaluate(std::string const& input, Limits const& limits) -> Result;
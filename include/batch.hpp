@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "solution.hpp"
+
+// Per-expression error codes written by evaluate_batch.
+enum class BatchError : std::uint8_t
+{
+    none = 0,
+    syntax = 1,
+    divide_by_zero = 2,
+    overflow = 3,
+    invalid_operation = 4
+};
+
+// Evaluates `count` expressions packed into one buffer: expression i is the bytes
+// [data + offsets[i], data + offsets[i + 1]), so `offsets` holds count + 1 entries.
+// Results go to caller-owned columns: `values[i]`, bit i of `validity` (LSB first, set when the
+// value is valid) and `errors[i]`. Scratch buffers are reused per thread, so no allocation is
+// made per expression.
+//
+// With `strict` set, rows that raise a floating-point divide-by-zero, overflow or invalid
+// exception are reported as errors too. The exception flags are only tested once per block of
+// 64 rows; the rows of a block that raised one are then re-evaluated one by one.
+auto evaluate_batch(char const* data, std::size_t const* offsets, std::size_t count,
+    double* values, std::uint8_t* validity, BatchError* errors, bool strict = false) -> void;
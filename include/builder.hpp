@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+#include "solution.hpp"
+
+// Expression templates that build the same postfix programs infix_to_postfix produces, without
+// going through a string. C++ gives * and / the same precedence and left associativity as the
+// parser, so `lit(5) + lit(8) / 2` yields the program of "5 + 8 / 2".
+
+struct Literal
+{
+    static constexpr std::size_t size = 1;
+    static constexpr std::size_t depth = 1;
+
+    double value;
+
+    template<typename OutputIterator>
+    auto emit(OutputIterator out) const -> OutputIterator
+    {
+        *out++ = value;
+
+        return out;
+    }
+};
+
+template<typename L, typename R>
+struct BinaryExpression
+{
+    static constexpr std::size_t size = L::size + R::size + 1;
+    static constexpr std::size_t depth = std::max(L::depth, R::depth + 1);
+
+    char op;
+    L left;
+    R right;
+
+    template<typename OutputIterator>
+    auto emit(OutputIterator out) const -> OutputIterator
+    {
+        out = left.emit(out);
+        out = right.emit(out);
+        *out++ = op;
+
+        return out;
+    }
+};
+
+template<typename T>
+struct is_expression : std::false_type
+{
+};
+
+template<>
+struct is_expression<Literal> : std::true_type
+{
+};
+
+template<typename L, typename R>
+struct is_expression<BinaryExpression<L, R>> : std::true_type
+{
+};
+
+inline auto lit(double value) -> Literal
+{
+    return {value};
+}
+
+template<typename T>
+auto as_expression(T const& v)
+{
+    if constexpr (is_expression<T>::value)
+    {
+        return v;
+    }
+    else
+    {
+        return lit(v);
+    }
+}
+
+template<typename L, typename R>
+using enable_if_expression = std::enable_if_t<
+    (is_expression<L>::value || is_expression<R>::value)
+    && (is_expression<L>::value || std::is_arithmetic_v<L>)
+    && (is_expression<R>::value || std::is_arithmetic_v<R>)>;
+
+template<typename L, typename R>
+auto make_binary(char op, L const& l, R const& r)
+{
+    using left_type = decltype(as_expression(l));
+    using right_type = decltype(as_expression(r));
+
+    return BinaryExpression<left_type, right_type>{op, as_expression(l), as_expression(r)};
+}
+
+template<typename L, typename R, typename = enable_if_expression<L, R>>
+auto operator+(L const& l, R const& r)
+{
+    return make_binary('+', l, r);
+}
+
+template<typename L, typename R, typename = enable_if_expression<L, R>>
+auto operator-(L const& l, R const& r)
+{
+    return make_binary('-', l, r);
+}
+
+template<typename L, typename R, typename = enable_if_expression<L, R>>
+auto operator*(L const& l, R const& r)
+{
+    return make_binary('*', l, r);
+}
+
+template<typename L, typename R, typename = enable_if_expression<L, R>>
+auto operator/(L const& l, R const& r)
+{
+    return make_binary('/', l, r);
+}
+
+// A postfix program whose size is known at compile time; it lives wherever it is declared.
+template<std::size_t N>
+struct Program
+{
+    std::array<symbol, N> postfix;
+    std::size_t max_depth;
+
+    [[nodiscard]] auto begin() const
+    {
+        return postfix.begin();
+    }
+
+    [[nodiscard]] auto end() const
+    {
+        return postfix.end();
+    }
+};
+
+template<typename E, typename = std::enable_if_t<is_expression<E>::value>>
+auto compile(E const& expression) -> Program<E::size>
+{
+    Program<E::size> program{{}, E::depth};
+    expression.emit(program.postfix.begin());
+
+    return program;
+}
+
+template<std::size_t N>
+auto evaluate(Program<N> const& program) -> Result
+{
+    return {evaluate_postfix(program, program.max_depth), false};
+}
+
+template<typename E, typename = std::enable_if_t<is_expression<E>::value>>
+auto evaluate(E const& expression) -> Result
+{
+    return evaluate(compile(expression));
+}
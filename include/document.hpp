@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "solution.hpp"
+
+struct DocumentGroup;
+
+// An expression that is edited in place, as in a formula editor. The document keeps its parse
+// as a tree of parenthesized groups, each caching its value and, per run of its items, the
+// products of its terms. An edit re-scans only the tokens it can change, in the innermost
+// group that contains it, and refolds that group and the enclosing ones from cached parts.
+// While the text does not parse, the tree is kept, with the groups that do not parse marked,
+// so an edit that fixes the text costs no more than any other.
+class Document
+{
+public:
+    explicit Document(std::string text = "");
+
+    Document(Document const&) = delete;
+    auto operator=(Document const&) -> Document& = delete;
+    Document(Document&&) noexcept;
+    auto operator=(Document&&) noexcept -> Document&;
+
+    ~Document();
+
+    // Replaces `removed` bytes at `offset` with `inserted` and returns the new result, which
+    // is always equal to evaluate(text()). Throws std::out_of_range if `offset` is past the
+    // end of the text.
+    auto edit(std::size_t offset, std::size_t removed, std::string_view inserted) -> Result;
+
+    [[nodiscard]] auto result() const -> Result
+    {
+        return m_result;
+    }
+
+    [[nodiscard]] auto text() const -> std::string const&
+    {
+        return m_text;
+    }
+
+private:
+    auto reparse_all() -> void;
+
+    std::string m_text;
+    std::unique_ptr<DocumentGroup> m_root;
+    Result m_result{0, true};
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "solution.hpp"
+
+// A postfix program lowered to a flat instruction array. Operators are dispatched with a
+// switch instead of through get_operator, and an operator whose right operand is a literal is
+// fused with it into one instruction. Results are bit-identical to evaluate_postfix.
+class FlatProgram
+{
+public:
+    // `postfix` must be a valid program and `max_depth` its depth, as from
+    // infix_to_postfix_into.
+    FlatProgram(std::vector<symbol> const& postfix, std::size_t max_depth);
+
+    [[nodiscard]] auto run() const -> double;
+
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_code.size();
+    }
+
+private:
+    enum class Code : std::uint8_t
+    {
+        push,
+        add,
+        sub,
+        mul,
+        div,
+        add_imm,
+        sub_imm,
+        mul_imm,
+        div_imm
+    };
+
+    struct Instruction
+    {
+        Code code;
+        double imm;
+    };
+
+    std::vector<Instruction> m_code;
+    std::size_t m_max_depth;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "solution.hpp"
+
+// Compiles a batch of expressions into a single program. Their trees are hash-consed into one
+// DAG, so a subexpression shared by several expressions (or repeated inside one) is computed
+// once per evaluation.
+class FusedProgram
+{
+public:
+    explicit FusedProgram(std::vector<std::string> const& inputs);
+
+    // Writes one Result per input expression, in the order they were given.
+    auto evaluate(Result* out) const -> void;
+    [[nodiscard]] auto evaluate() const -> std::vector<Result>;
+
+    [[nodiscard]] auto outputs() const -> std::size_t
+    {
+        return m_outputs.size();
+    }
+
+    // Number of distinct subexpressions, i.e. values computed per evaluation.
+    [[nodiscard]] auto nodes() const -> std::size_t
+    {
+        return m_nodes.size();
+    }
+
+private:
+    static constexpr std::size_t no_node = ~std::size_t{0};
+
+    // A constant when op is 0, otherwise op applied to the values of two earlier nodes.
+    struct Node
+    {
+        char op;
+        double value;
+        std::size_t left;
+        std::size_t right;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<std::size_t> m_outputs;
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "solution.hpp"
+
+// Key of an expression in a MemoStore: two independent 64 bit hashes of its token stream.
+// Tokenizing normalizes away whitespace and number spelling, so "1.0+2" and "1 + 2" share a
+// key.
+struct MemoKey
+{
+    std::uint64_t hash;
+    std::uint64_t check;
+};
+
+auto memo_key(std::vector<symbol> const& tokens) -> MemoKey;
+
+// A persistent memo of expression results: an open-addressing hash table in a memory-mapped
+// file. Any number of processes may open it read-only while one process (enforced with an
+// exclusive lock on the file) opens it writable and inserts. Within that process, inserts
+// from several threads are serialized. A slot's key is published last, so readers never see
+// a partially written entry.
+//
+// The table never grows: once full(), inserts fail and only lookups are answered.
+class MemoStore
+{
+public:
+    // About 3 million entries, in a 128 MB file.
+    static constexpr std::size_t default_capacity = std::size_t{3} << 20;
+
+    // Opens the store at `path`. A writable store creates the file with room for at least
+    // `capacity` entries if it does not exist. Throws std::runtime_error if the file cannot be
+    // opened or mapped, is not a store, or is already open for writing.
+    MemoStore(std::string const& path, bool writable, std::size_t capacity = default_capacity);
+
+    MemoStore(MemoStore const&) = delete;
+    auto operator=(MemoStore const&) -> MemoStore& = delete;
+
+    ~MemoStore();
+
+    [[nodiscard]] auto lookup(MemoKey const& key) const -> std::optional<Result>;
+
+    // Stores `result` under `key`. Returns false if the store is read-only or full.
+    auto insert(MemoKey const& key, Result const& result) -> bool;
+
+    // True once the store holds as many entries as it has room for.
+    [[nodiscard]] auto full() const -> bool;
+
+    [[nodiscard]] auto writable() const -> bool
+    {
+        return m_writable;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t;
+
+private:
+    struct Header;
+    struct Slot;
+
+    int m_fd = -1;
+    bool m_writable;
+    void* m_map = nullptr;
+    std::size_t m_map_size = 0;
+    Header* m_header = nullptr;
+    Slot* m_slots = nullptr;
+    std::mutex m_insert_mutex;
+};
+
+// Like evaluate(input), but answers from `store` when the token stream was seen before, and
+// records new results when the store is writable and not full. Safe to call from several
+// threads on one store.
+auto evaluate(std::string const& input, MemoStore& store) -> Result;
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "solution.hpp"
+
+constexpr std::size_t default_parallel_threshold = std::size_t{1} << 14;
+
+// Evaluates `input` like evaluate(), on at most `threads` threads; 0 means one per hardware
+// thread. The input is scanned in chunks, parenthesized groups of at least `threshold` symbols
+// are converted to postfix on their own, and independent subtrees of at least `threshold`
+// symbols are reduced on separate threads. Every operation keeps its operands, so the result
+// is bit-identical to the serial one. Only groups and balanced subtrees split conversion and
+// reduction: a flat chain of operators is only scanned in parallel.
+auto evaluate_parallel(std::string const& input,
+    std::size_t threshold = default_parallel_threshold, unsigned threads = 0) -> Result;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "circular.hpp"
+#include "ring_buffer.hpp"
+#include "scanner.hpp"
+#include "small_vector.hpp"
+#include "solution.hpp"
+#include "token.hpp"
+
+// Container policies pick the symbol type and the container used for the token stream, the
+// postfix program and the operator stack. The value stack is always the preallocated one from
+// evaluate_postfix.
+
+struct circular_policy
+{
+    using token = symbol;
+
+    template<typename T>
+    using container = CircularList<T>;
+};
+
+struct small_vector_policy
+{
+    using token = symbol;
+
+    template<typename T>
+    using container = SmallVector<T>;
+};
+
+struct ring_buffer_policy
+{
+    using token = symbol;
+
+    template<typename T>
+    using container = RingBuffer<T>;
+};
+
+// 8 byte NaN-boxed tokens in plain vectors: a million token program takes 8 MB.
+struct compact_policy
+{
+    using token = Token;
+
+    template<typename T>
+    using container = std::vector<T>;
+};
+
+template<typename policy>
+auto evaluate_with(std::string const& input) -> Result
+{
+    using symbols = typename policy::template container<typename policy::token>;
+    using chars = typename policy::template container<char>;
+
+    try
+    {
+        symbols infix;
+        scan_tokens(input, infix);
+
+        symbols postfix;
+        chars ops;
+        auto max_depth = infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+
+        return {evaluate_postfix(postfix, max_depth), false};
+    }
+    catch (InfixError&)
+    {
+        return {0, true};
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+// A growable circular buffer over one contiguous allocation. Works as a stack (push_back,
+// pop_back) and as a queue (push_back, pop_front). The capacity is always a power of two so
+// positions wrap with a mask. Elements must be default constructible.
+template<typename T>
+class RingBuffer
+{
+public:
+    template<typename Buffer, typename Value>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        basic_iterator(Buffer* buffer, std::size_t index)
+            : m_buffer(buffer),
+              m_index(index)
+        {
+        }
+
+        auto operator*() const -> reference
+        {
+            return m_buffer->at(m_index);
+        }
+
+        auto operator->() const -> pointer
+        {
+            return &m_buffer->at(m_index);
+        }
+
+        auto operator++() -> basic_iterator&
+        {
+            m_index++;
+
+            return *this;
+        }
+
+        auto operator++(int) -> basic_iterator
+        {
+            auto ret = *this;
+            m_index++;
+
+            return ret;
+        }
+
+        auto operator==(basic_iterator const& other) const -> bool
+        {
+            return m_index == other.m_index;
+        }
+
+        auto operator!=(basic_iterator const& other) const -> bool
+        {
+            return m_index != other.m_index;
+        }
+
+    private:
+        Buffer* m_buffer;
+        std::size_t m_index;
+    };
+
+    using iterator = basic_iterator<RingBuffer, T>;
+    using const_iterator = basic_iterator<RingBuffer const, T const>;
+
+    RingBuffer() = default;
+
+    RingBuffer(std::initializer_list<T> values)
+    {
+        for (auto const& v : values)
+        {
+            push_back(v);
+        }
+    }
+
+    template<typename... Args>
+    auto emplace_back(Args&&... args) -> T&
+    {
+        if (m_size == m_buffer.size())
+        {
+            grow();
+        }
+
+        T& slot = at(m_size++);
+        slot = T(std::forward<Args>(args)...);
+
+        return slot;
+    }
+
+    auto push_back(T const& value) -> void
+    {
+        emplace_back(value);
+    }
+
+    auto pop_back() -> void
+    {
+        m_size--;
+    }
+
+    auto pop_front() -> void
+    {
+        m_head = (m_head + 1) & (m_buffer.size() - 1);
+        m_size--;
+    }
+
+    auto front() -> T&
+    {
+        return at(0);
+    }
+
+    auto back() -> T&
+    {
+        return at(m_size - 1);
+    }
+
+    [[nodiscard]] auto front() const -> T const&
+    {
+        return at(0);
+    }
+
+    [[nodiscard]] auto back() const -> T const&
+    {
+        return at(m_size - 1);
+    }
+
+    auto clear() -> void
+    {
+        m_head = 0;
+        m_size = 0;
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+        return m_size == 0;
+    }
+
+    auto begin() -> iterator
+    {
+        return {this, 0};
+    }
+
+    auto end() -> iterator
+    {
+        return {this, m_size};
+    }
+
+    [[nodiscard]] auto begin() const -> const_iterator
+    {
+        return {this, 0};
+    }
+
+    [[nodiscard]] auto end() const -> const_iterator
+    {
+        return {this, m_size};
+    }
+
+    auto operator==(RingBuffer const& other) const -> bool
+    {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+    // Element `i` counting from the front.
+    auto at(std::size_t i) -> T&
+    {
+        return m_buffer[(m_head + i) & (m_buffer.size() - 1)];
+    }
+
+    [[nodiscard]] auto at(std::size_t i) const -> T const&
+    {
+        return m_buffer[(m_head + i) & (m_buffer.size() - 1)];
+    }
+
+private:
+    auto grow() -> void
+    {
+        std::vector<T> buffer(std::max<std::size_t>(2 * m_buffer.size(), 16));
+        for (std::size_t i = 0; i < m_size; i++)
+        {
+            buffer[i] = std::move(at(i));
+        }
+
+        m_buffer = std::move(buffer);
+        m_head = 0;
+    }
+
+    std::vector<T> m_buffer;
+    std::size_t m_head = 0;
+    std::size_t m_size = 0;
+};
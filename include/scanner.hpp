@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+#include "solution.hpp"
+
+// The tokenizer's character classes. classify_block computes the same classes for a whole
+// block at once.
+inline auto is_space(char c) -> bool
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline auto is_digit(char c) -> bool
+{
+    return c >= '0' && c <= '9';
+}
+
+// Names, which only scan_tokens with a name handler reads, start with a letter or '_' and go
+// on with letters, digits and '_'.
+inline auto is_name_start(char c) -> bool
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+inline auto is_name_char(char c) -> bool
+{
+    return is_name_start(c) || is_digit(c);
+}
+
+// Classification of a block of up to 64 input bytes. Bit i of each mask describes byte i of
+// the block; bits past the end of the block are always clear.
+struct char_masks
+{
+    std::uint64_t space;
+    std::uint64_t digit;
+    std::uint64_t number; // Bytes a number can continue with: digits, '.', 'e' and 'E'.
+};
+
+constexpr std::size_t scan_block_size = 64;
+
+// Classifies the `n` (at most scan_block_size) bytes starting at `p`. Uses AVX2 or SSE2 when
+// the CPU supports them and falls back to a scalar loop otherwise.
+auto classify_block(char const* p, std::size_t n) -> char_masks;
+
+// Whether the number in [b, e), which from_chars found out of the range of double, is too
+// small rather than too large: counted from its first significant digit, its decimal exponent
+// is negative.
+inline auto is_underflow(char const* b, char const* e) -> bool
+{
+    constexpr std::int64_t saturated = std::int64_t{1} << 48;
+
+    std::int64_t order = 0;
+    bool significant = false;
+    bool fraction = false;
+    char const* p = b;
+    for (; p != e && (is_digit(*p) || *p == '.'); p++)
+    {
+        if (*p == '.')
+        {
+            fraction = true;
+        }
+        else if (!fraction)
+        {
+            significant = significant || *p != '0';
+            order += significant ? 1 : 0;
+        }
+        else if (!significant)
+        {
+            significant = *p != '0';
+            order -= significant ? 0 : 1;
+        }
+    }
+
+    // from_chars only takes the 'e' or 'E' with the digits of an exponent after it.
+    std::int64_t exponent = 0;
+    bool negative = false;
+    if (p != e)
+    {
+        p++;
+        negative = *p == '-';
+        p += *p == '-' || *p == '+' ? 1 : 0;
+    }
+
+    for (; p != e; p++)
+    {
+        exponent = std::min(exponent * 10 + (*p - '0'), saturated);
+    }
+
+    return order + (negative ? -exponent : exponent) < 0;
+}
+
+// Reads the number at `b` with from_chars and returns its end. A number below the range of
+// double reads as 0, as it did with istream; for one above it, `fits` is set to false.
+inline auto read_number(char const* b, char const* e, double& value, bool& fits)
+    -> char const*
+{
+    auto [ptr, ec] = std::from_chars(b, e, value);
+    fits = ec == std::errc();
+    if (ec == std::errc::result_out_of_range && is_underflow(b, ptr))
+    {
+        value = 0;
+        fits = true;
+    }
+
+    return ptr;
+}
+
+inline auto parse_number(char const* b, char const* e, double& value) -> char const*
+{
+    bool fits = true;
+    char const* ptr = read_number(b, e, value, fits);
+    if (!fits)
+    {
+        throw InfixError();
+    }
+
+    return ptr;
+}
+
+// Reads the token at `p`, which must be before `end` and not whitespace, the way scan_tokens
+// does, and returns its end. Where scan_tokens would throw InfixError for a number above the
+// range of double, this sets `fits` to false instead.
+inline auto scan_token(char const* p, char const* end, symbol& token, bool& fits)
+    -> char const*
+{
+    fits = true;
+    if (!is_digit(*p))
+    {
+        token = *p;
+
+        return p + 1;
+    }
+
+    double value = 0;
+    char const* ptr = read_number(p, end, value, fits);
+    token = value;
+
+    return ptr;
+}
+
+// Length of the run of set bits in `mask` starting at bit `pos`.
+inline auto mask_run(std::uint64_t mask, unsigned pos) -> unsigned
+{
+    std::uint64_t rest = ~(mask >> pos);
+
+    return rest == 0 ? 64 : unsigned(__builtin_ctzll(rest));
+}
+
+// Reads the number starting at bit `pos` of a classified block straight from its masks, if it
+// is a plain integer or decimal ("12", "0.25", "3.") with at most 15 digits and it ends inside
+// the block (or the block ends the input). Such a number and every power of ten it is divided
+// by are exact doubles, so one division rounds exactly like from_chars. Returns the number's
+// length, or 0 when from_chars has to read it.
+inline auto scan_simple_number(char const* block, std::size_t block_len, bool last_block,
+    char_masks const& masks, unsigned pos, double& value) -> unsigned
+{
+    static constexpr double powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    constexpr unsigned max_digits = 15;
+
+    unsigned length = mask_run(masks.number, pos);
+    if (pos + length >= block_len && !last_block)
+    {
+        return 0;
+    }
+
+    unsigned int_digits = mask_run(masks.digit, pos);
+    unsigned frac_digits = 0;
+    if (int_digits != length)
+    {
+        unsigned dot = pos + int_digits;
+        if (block[dot] != '.')
+        {
+            return 0;
+        }
+
+        frac_digits = dot + 1 < scan_block_size ? mask_run(masks.digit, dot + 1) : 0;
+        if (int_digits + 1 + frac_digits != length)
+        {
+            return 0;
+        }
+    }
+
+    if (int_digits + frac_digits > max_digits)
+    {
+        return 0;
+    }
+
+    std::uint64_t mantissa = 0;
+    for (unsigned i = pos; i < pos + length; i++)
+    {
+        if (block[i] != '.')
+        {
+            mantissa = mantissa * 10 + unsigned(block[i] - '0');
+        }
+    }
+
+    value = double(mantissa);
+    if (frac_digits != 0)
+    {
+        value /= powers_of_ten[frac_digits];
+    }
+
+    return length;
+}
+
+// The default name handler of scan_tokens: names are not tokens, so each of their bytes is one.
+struct no_names
+{
+};
+
+// Splits `input` into symbols, appending them to `out`. Numbers start with a digit; every
+// other non whitespace byte is a token of its own. With a name handler, a name is passed to
+// `on_name` as a whole instead.
+template<typename container, typename names = no_names>
+auto scan_tokens(std::string_view input, container& out, names on_name = {}) -> void
+{
+    char const* block = input.data();
+    char const* const end = block + input.size();
+
+    while (block < end)
+    {
+        std::size_t block_len = std::min(scan_block_size, std::size_t(end - block));
+        bool last_block = block + block_len == end;
+        char_masks masks = classify_block(block, block_len);
+
+        std::uint64_t valid = block_len == scan_block_size
+            ? ~std::uint64_t{0}
+            : (std::uint64_t{1} << block_len) - 1;
+        std::uint64_t pending = ~masks.space & valid;
+        char const* next = block + block_len;
+
+        while (pending != 0)
+        {
+            auto pos = unsigned(__builtin_ctzll(pending));
+            std::size_t length = 0;
+
+            if ((masks.digit >> pos & 1) != 0)
+            {
+                double value = 0;
+                length = scan_simple_number(block, block_len, last_block, masks, pos, value);
+                if (length == 0)
+                {
+                    length = std::size_t(parse_number(block + pos, end, value) - (block + pos));
+                }
+
+                out.emplace_back(value);
+            }
+            else if constexpr (!std::is_same_v<names, no_names>)
+            {
+                if (!is_name_start(block[pos]))
+                {
+                    out.emplace_back(block[pos]);
+                    pending &= pending - 1;
+                    continue;
+                }
+
+                char const* name_end = std::find_if_not(block + pos, end, is_name_char);
+                length = std::size_t(name_end - (block + pos));
+                on_name(std::string_view(block + pos, length));
+            }
+            else
+            {
+                out.emplace_back(block[pos]);
+                pending &= pending - 1;
+                continue;
+            }
+
+            // A number or name may run past the block; scanning resumes after it.
+            if (pos + length >= block_len)
+            {
+                next = block + pos + length;
+                break;
+            }
+
+            pending &= ~std::uint64_t{0} << (pos + length);
+        }
+
+        block = next;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "solution.hpp"
+
+// A sequence of named definitions such as "a = 3 * x; b = a + y; c = (a - b) / 2".
+// Definitions are separated by ';' or newlines. Their expressions follow the grammar of
+// tokenize, extended with names (see is_name_start): the names defined before them and input
+// names that are never defined (x and y above), whose values are supplied per row. The
+// definitions form a dependency graph that is evaluated level by level: every definition is
+// computed once per row, after the ones it uses, and the definitions of a level are
+// independent of each other, so they are evaluated in parallel.
+class Script
+{
+public:
+    // Throws InfixError if a definition is malformed or a name is defined twice.
+    explicit Script(std::string const& source);
+
+    // Input names, in the order their values are expected in a row.
+    [[nodiscard]] auto inputs() const -> std::vector<std::string> const&
+    {
+        return m_inputs;
+    }
+
+    // Defined names, in the order their values are written in a row.
+    [[nodiscard]] auto names() const -> std::vector<std::string> const&
+    {
+        return m_names;
+    }
+
+    // Number of dependency levels; definitions in a level do not use each other.
+    [[nodiscard]] auto levels() const -> std::size_t
+    {
+        return m_levels.size();
+    }
+
+    // Evaluates `rows` rows. `inputs` holds inputs().size() values per row and `outputs`
+    // receives names().size() values per row, both row by row. Uses up to `threads` threads.
+    auto evaluate(double const* inputs, std::size_t rows, double* outputs, unsigned threads = 1)
+        const -> void;
+
+    // Evaluates a single row. Throws std::invalid_argument if `inputs` does not hold one value
+    // per input.
+    [[nodiscard]] auto evaluate(std::vector<double> const& inputs) const -> std::vector<double>;
+
+private:
+    // A postfix operand or operator. Operands are numbers or slots: inputs first, then
+    // definitions.
+    struct Step
+    {
+        bool is_op;
+        char op;
+        std::size_t slot;
+        double value;
+    };
+
+    static constexpr std::size_t no_slot = ~std::size_t{0};
+
+    struct Definition
+    {
+        std::vector<Step> postfix;
+        std::size_t max_depth;
+    };
+
+    auto evaluate_definition(std::size_t d, std::vector<double>& columns, std::size_t rows,
+        std::size_t first_row, std::size_t last_row) const -> void;
+
+    std::vector<std::string> m_inputs;
+    std::vector<std::string> m_names;
+    std::vector<Definition> m_definitions;
+    std::vector<std::vector<std::size_t>> m_levels;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// A contiguous vector that keeps up to N elements inline and only moves to the heap once it
+// grows past them. Elements must be default constructible.
+template<typename T, std::size_t N = 32>
+class SmallVector
+{
+public:
+    SmallVector() = default;
+
+    SmallVector(std::initializer_list<T> values)
+    {
+        for (auto const& v : values)
+        {
+            push_back(v);
+        }
+    }
+
+    SmallVector(SmallVector const& other)
+    {
+        *this = other;
+    }
+
+    SmallVector(SmallVector&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    ~SmallVector() = default;
+
+    auto operator=(SmallVector const& other) -> SmallVector&
+    {
+        if (this != &other)
+        {
+            clear();
+            reserve(other.m_size);
+            std::copy(other.begin(), other.end(), data());
+            m_size = other.m_size;
+        }
+
+        return *this;
+    }
+
+    auto operator=(SmallVector&& other) noexcept -> SmallVector&
+    {
+        if (this != &other)
+        {
+            m_heap = std::move(other.m_heap);
+            std::size_t inline_size = std::min(other.m_size, N);
+            std::move(
+                other.m_inline.begin(), other.m_inline.begin() + inline_size, m_inline.begin());
+            m_size = other.m_size;
+            other.m_heap.clear();
+            other.m_size = 0;
+        }
+
+        return *this;
+    }
+
+    template<typename... Args>
+    auto emplace_back(Args&&... args) -> T&
+    {
+        reserve(m_size + 1);
+
+        T& slot = data()[m_size++];
+        slot = T(std::forward<Args>(args)...);
+
+        return slot;
+    }
+
+    auto push_back(T const& value) -> void
+    {
+        emplace_back(value);
+    }
+
+    auto pop_back() -> void
+    {
+        m_size--;
+    }
+
+    auto back() -> T&
+    {
+        return data()[m_size - 1];
+    }
+
+    auto back() const -> T const&
+    {
+        return data()[m_size - 1];
+    }
+
+    auto clear() -> void
+    {
+        m_size = 0;
+    }
+
+    auto reserve(std::size_t capacity) -> void
+    {
+        if (capacity <= N || capacity <= m_heap.size())
+        {
+            return;
+        }
+
+        bool was_inline = m_heap.empty();
+        m_heap.resize(std::max({capacity, 2 * m_heap.size(), 2 * N}));
+        if (was_inline)
+        {
+            std::move(m_inline.begin(), m_inline.begin() + m_size, m_heap.begin());
+        }
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] auto empty() const -> bool
+    {
+        return m_size == 0;
+    }
+
+    auto data() -> T*
+    {
+        return m_heap.empty() ? m_inline.data() : m_heap.data();
+    }
+
+    [[nodiscard]] auto data() const -> T const*
+    {
+        return m_heap.empty() ? m_inline.data() : m_heap.data();
+    }
+
+    auto begin() -> T*
+    {
+        return data();
+    }
+
+    auto end() -> T*
+    {
+        return data() + m_size;
+    }
+
+    [[nodiscard]] auto begin() const -> T const*
+    {
+        return data();
+    }
+
+    [[nodiscard]] auto end() const -> T const*
+    {
+        return data() + m_size;
+    }
+
+    auto operator==(SmallVector const& other) const -> bool
+    {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+private:
+    std::array<T, N> m_inline{};
+    std::vector<T> m_heap;
+    std::size_t m_size = 0;
+};
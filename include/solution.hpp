@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <functional>
 #include <ostream>
 #include <sstream>
@@ -26,19 +29,36 @@ struct overload : Ts...
 template<class... Ts>
 overload(Ts...) -> overload<Ts...>;
 
+// Why a Result has its error flag set.
+enum class ErrorKind : unsigned char
+{
+    syntax,
+    limit,
+    divide_by_zero,
+    overflow,
+    invalid_operation
+};
+
 struct Result
 {
     double result;
     bool error;
+    ErrorKind kind = ErrorKind::syntax; // Only meaningful when error is set.
 
     auto operator==(Result const& other) const -> bool
     {
-        return result == other.result && error == other.error;
+        return result == other.result && error == other.error
+            && (!error || kind == other.kind);
     }
 
     friend auto operator<<(std::ostream& out, Result const& result) -> std::ostream&
     {
-        out << "<" << result.result << ", " << result.error << ">";
+        out << "<" << result.result << ", " << result.error;
+        if (result.error)
+        {
+            out << ", " << static_cast<unsigned>(result.kind);
+        }
+        out << ">";
 
         return out;
     }
@@ -57,6 +77,7 @@ struct Operator
 };
 
 auto get_operator(char c) -> Operator;
+auto is_operator(char c) -> bool;
 
 class InfixError : public std::exception
 {
@@ -76,11 +97,34 @@ public:
     }
 };
 
+// Symbol accessors. Programs are generic over their symbol type (see also Token), which only
+// needs these three functions; the accessors do not check the alternative held.
+inline auto is_number(symbol const& s) -> bool
+{
+    return std::holds_alternative<double>(s);
+}
+
+inline auto as_number(symbol const& s) -> double
+{
+    return *std::get_if<double>(&s);
+}
+
+inline auto as_operator(symbol const& s) -> char
+{
+    return *std::get_if<char>(&s);
+}
+
 auto evaluate(std::string const& input) -> Result;
 auto tokenize(std::string const& input) -> eval_container<symbol>;
 
-template<template<typename...> typename container, typename ForwardIterator>
-auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
+// Converts the infix symbols in [b, e) into postfix, appending them to `postfix` and using
+// `ops` as the operator stack. The whole program is validated, so the result can be evaluated
+// without further checks. Returns the maximum depth the value stack reaches while evaluating
+// it.
+template<typename ForwardIterator, typename postfix_container, typename ops_container>
+auto infix_to_postfix_into(
+    ForwardIterator b, ForwardIterator e, postfix_container& postfix, ops_container& ops)
+    -> std::size_t
 {
     enum class symbol_types
     {
@@ -90,22 +134,21 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
         right_par
     };
 
-    static auto symbol_type = [](symbol v) {
-        return std::visit(
-            overload{
-                [](double) { return symbol_types::number; },
-                [](char c) {
-                    switch (c)
-                    {
-                    case '(':
-                        return symbol_types::left_par;
-                    case ')':
-                        return symbol_types::right_par;
-                    default:
-                        return symbol_types::op;
-                    };
-                }},
-            v);
+    static auto symbol_type = [](auto const& v) {
+        if (is_number(v))
+        {
+            return symbol_types::number;
+        }
+
+        switch (as_operator(v))
+        {
+        case '(':
+            return symbol_types::left_par;
+        case ')':
+            return symbol_types::right_par;
+        default:
+            return symbol_types::op;
+        };
     };
 
     if (b == e)
@@ -113,8 +156,13 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
         throw InfixError();
     }
 
-    container<symbol> postfix;
-    container<char> ops;
+    std::size_t depth = 0;
+    std::size_t max_depth = 0;
+
+    auto emit_op = [&postfix, &depth](char c) {
+        postfix.emplace_back(c);
+        depth--;
+    };
 
     auto prev_s_type = symbol_types::left_par;
     for (auto it = b; it != e; it++)
@@ -129,10 +177,12 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
             }
 
             postfix.emplace_back(*it);
+            depth++;
+            max_depth = std::max(max_depth, depth);
         }
         else
         {
-            char c = std::get<char>(*it);
+            char c = as_operator(*it);
 
             if (s_type == symbol_types::left_par)
             {
@@ -150,15 +200,23 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
                     throw InfixError();
                 }
 
-                char c = 0;
-                while (c = ops.back(), ops.pop_back(), c != '(')
+                while (!ops.empty() && ops.back() != '(')
+                {
+                    emit_op(ops.back());
+                    ops.pop_back();
+                }
+
+                if (ops.empty())
                 {
-                    postfix.emplace_back(c);
+                    throw InfixError();
                 }
+
+                ops.pop_back();
             }
             else
             {
-                if (prev_s_type == symbol_types::op || prev_s_type == symbol_types::left_par)
+                if (prev_s_type == symbol_types::op || prev_s_type == symbol_types::left_par
+                    || !is_operator(c))
                 {
                     throw InfixError();
                 }
@@ -170,7 +228,7 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
                        && (prev_op = ops.back(),
                            get_operator(prev_op).precedence <= cur_op.precedence))
                 {
-                    postfix.emplace_back(ops.back());
+                    emit_op(ops.back());
                     ops.pop_back();
                 }
 
@@ -181,15 +239,45 @@ auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
         prev_s_type = s_type;
     }
 
+    if (prev_s_type == symbol_types::op || prev_s_type == symbol_types::left_par)
+    {
+        throw InfixError();
+    }
+
     while (!ops.empty())
     {
-        postfix.emplace_back(ops.back());
+        if (ops.back() == '(')
+        {
+            throw InfixError();
+        }
+
+        emit_op(ops.back());
         ops.pop_back();
     }
 
+    return max_depth;
+}
+
+template<template<typename...> typename container, typename ForwardIterator>
+auto infix_to_postfix(ForwardIterator b, ForwardIterator e, std::size_t& max_depth)
+    -> container<symbol>
+{
+    container<symbol> postfix;
+    container<char> ops;
+
+    max_depth = infix_to_postfix_into(b, e, postfix, ops);
+
     return postfix;
 }
 
+template<template<typename...> typename container, typename ForwardIterator>
+auto infix_to_postfix(ForwardIterator b, ForwardIterator e) -> container<symbol>
+{
+    std::size_t max_depth = 0;
+
+    return infix_to_postfix<container>(b, e, max_depth);
+}
+
 template<template<typename...> typename result_container = eval_container,
     template<typename...> typename container>
 auto infix_to_postfix(container<symbol> const& cn) -> result_container<symbol>
@@ -197,6 +285,44 @@ auto infix_to_postfix(container<symbol> const& cn) -> result_container<symbol>
     return infix_to_postfix<result_container>(cn.begin(), cn.end());
 }
 
+// Evaluates a postfix program produced by infix_to_postfix. The program must be valid and
+// `max_depth` must be the depth reported for it: the value stack is not bounds checked.
+template<typename container>
+auto evaluate_postfix(container const& postfix, std::size_t max_depth) -> double
+{
+    constexpr std::size_t local_capacity = 64;
+
+    std::array<double, local_capacity> local_stack;
+    thread_local std::vector<double> shared_stack;
+
+    double* stack = local_stack.data();
+    if (max_depth > local_capacity)
+    {
+        if (shared_stack.size() < max_depth)
+        {
+            shared_stack.resize(max_depth);
+        }
+
+        stack = shared_stack.data();
+    }
+
+    double* top = stack;
+    for (auto const& e : postfix)
+    {
+        if (is_number(e))
+        {
+            *top++ = as_number(e);
+        }
+        else
+        {
+            top--;
+            top[-1] = get_operator(as_operator(e)).fn(top[-1], *top);
+        }
+    }
+
+    return stack[0];
+}
+
 auto operator<<(std::ostream& out, std::variant<double, char> const& v) -> std::ostream&;
 auto operator<<(std::ostream& out, eval_container<std::variant<double, char>> const& v)
     -> std::ostream&;
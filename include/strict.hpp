@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cfenv>
+#include <string>
+
+#include "solution.hpp"
+
+// The floating-point exceptions strict evaluation reports.
+constexpr int strict_exceptions = FE_DIVBYZERO | FE_OVERFLOW | FE_INVALID;
+
+// Picks the ErrorKind for the exceptions in `raised`, a set of FE_* flags. Returns false when
+// none of strict_exceptions is raised.
+auto strict_error(int raised, ErrorKind& kind) -> bool;
+
+// Saves the floating-point exception flags and restores them when it goes out of scope, so
+// strict evaluation does not clobber the caller's.
+class ExceptionFlagsGuard
+{
+public:
+    ExceptionFlagsGuard()
+    {
+        std::fegetexceptflag(&m_saved, FE_ALL_EXCEPT);
+    }
+
+    ExceptionFlagsGuard(ExceptionFlagsGuard const&) = delete;
+    auto operator=(ExceptionFlagsGuard const&) -> ExceptionFlagsGuard& = delete;
+
+    ~ExceptionFlagsGuard()
+    {
+        std::fesetexceptflag(&m_saved, FE_ALL_EXCEPT);
+    }
+
+private:
+    std::fexcept_t m_saved{};
+};
+
+// Like evaluate(input), but division by zero, overflow and invalid operations (such as 0 / 0)
+// are errors. They are detected from the exception flags after the evaluation, so the
+// operators themselves do no extra checks.
+auto evaluate_strict(std::string const& input) -> Result;
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "flat.hpp"
+#include "solution.hpp"
+
+// Evaluates expressions while counting how often each one is seen. Every expression is parsed
+// once and starts out interpreted: evaluate_postfix over its infix_to_postfix output. Once an
+// expression has been evaluated `promote_after` times it is queued for a background thread
+// that compiles it to a FlatProgram; callers keep interpreting it until the compiled program
+// is published, so promotion never blocks them. At most `capacity` expressions are kept; past
+// that, one that has not been evaluated since the evictor last passed it is dropped, and is
+// parsed again if it comes back.
+class TieredEvaluator
+{
+public:
+    struct Options
+    {
+        // 0 compiles an expression on its first evaluation, like 1.
+        std::uint64_t promote_after = 64;
+        // 0 keeps one expression, like 1.
+        std::size_t capacity = std::size_t{1} << 16;
+    };
+
+    struct Counters
+    {
+        std::uint64_t interpreted;
+        std::uint64_t compiled;
+        std::uint64_t errors;
+        std::uint64_t promotions;
+        std::uint64_t evictions;
+    };
+
+    TieredEvaluator();
+    explicit TieredEvaluator(Options options);
+
+    TieredEvaluator(TieredEvaluator const&) = delete;
+    auto operator=(TieredEvaluator const&) -> TieredEvaluator& = delete;
+
+    ~TieredEvaluator();
+
+    auto evaluate(std::string const& input) -> Result;
+
+    [[nodiscard]] auto counters() const -> Counters;
+
+    // Blocks until every queued promotion is done. Meant for tests and benchmarks.
+    auto wait_for_promotions() -> void;
+
+private:
+    struct Entry;
+
+    static auto parse(std::string const& input) -> std::shared_ptr<Entry>;
+    auto insert(std::string const& input, std::shared_ptr<Entry> entry)
+        -> std::shared_ptr<Entry>;
+    auto run(std::shared_ptr<Entry> const& entry) -> Result;
+    auto compile_loop() -> void;
+
+    Options m_options;
+
+    mutable std::shared_mutex m_entries_mutex;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> m_entries;
+    std::deque<std::string const*> m_order; // Keys of m_entries, in the evictor's order.
+
+    std::mutex m_queue_mutex;
+    std::condition_variable m_queue_cv;
+    std::condition_variable m_idle_cv;
+    std::deque<std::shared_ptr<Entry>> m_queue;
+    bool m_compiling = false;
+    bool m_stop = false;
+
+    std::atomic<std::uint64_t> m_interpreted{0};
+    std::atomic<std::uint64_t> m_compiled{0};
+    std::atomic<std::uint64_t> m_errors{0};
+    std::atomic<std::uint64_t> m_promotions{0};
+    std::uint64_t m_evictions = 0; // Guarded by m_entries_mutex.
+
+    std::thread m_compiler;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+// An 8 byte symbol. Numbers are stored as their own bits; operators and parentheses live in
+// the payload of a negative quiet NaN that no number is ever stored as (NaN numbers are
+// canonicalized to the positive quiet NaN).
+class Token
+{
+public:
+    Token(double value)
+    {
+        if (std::isnan(value))
+        {
+            m_bits = canonical_nan;
+        }
+        else
+        {
+            std::memcpy(&m_bits, &value, sizeof m_bits);
+        }
+    }
+
+    Token(char op)
+        : m_bits(op_tag | static_cast<unsigned char>(op))
+    {
+    }
+
+    Token()
+        : Token(0.0)
+    {
+    }
+
+    [[nodiscard]] auto is_number() const -> bool
+    {
+        return (m_bits & op_tag_mask) != op_tag;
+    }
+
+    [[nodiscard]] auto number() const -> double
+    {
+        double value = 0;
+        std::memcpy(&value, &m_bits, sizeof value);
+
+        return value;
+    }
+
+    [[nodiscard]] auto op() const -> char
+    {
+        return static_cast<char>(m_bits & 0xff);
+    }
+
+    auto operator==(Token const& other) const -> bool
+    {
+        return m_bits == other.m_bits;
+    }
+
+    friend auto operator<<(std::ostream& out, Token const& token) -> std::ostream&
+    {
+        if (token.is_number())
+        {
+            return out << token.number();
+        }
+
+        return out << token.op();
+    }
+
+private:
+    static constexpr std::uint64_t canonical_nan = 0x7ff8'0000'0000'0000;
+    static constexpr std::uint64_t op_tag = 0xfffc'0000'0000'0000;
+    static constexpr std::uint64_t op_tag_mask = 0xffff'ffff'ffff'ff00;
+
+    std::uint64_t m_bits;
+};
+
+static_assert(sizeof(Token) == 8);
+
+inline auto is_number(Token const& t) -> bool
+{
+    return t.is_number();
+}
+
+inline auto as_number(Token const& t) -> double
+{
+    return t.number();
+}
+
+inline auto as_operator(Token const& t) -> char
+{
+    return t.op();
+}
@@ -0,0 +1,102 @@
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "admission.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+
+namespace
+{
+    struct LimitExceeded
+    {
+    };
+
+    // A scan_tokens container that keeps nothing: it counts what it is given and throws
+    // LimitExceeded as soon as a count goes over its limit.
+    class LimitCounter
+    {
+    public:
+        explicit LimitCounter(Limits const& _limits)
+            : m_limits(_limits)
+        {
+        }
+
+        auto emplace_back(double) -> void
+        {
+            count_token();
+        }
+
+        auto emplace_back(char c) -> void
+        {
+            count_token();
+
+            if (c == '(')
+            {
+                check(++m_nesting, m_limits.max_nesting);
+            }
+            else if (c == ')')
+            {
+                m_nesting -= m_nesting > 0 ? 1 : 0;
+            }
+            else
+            {
+                check(++m_operations, m_limits.max_operations);
+            }
+        }
+
+    private:
+        static auto check(std::size_t count, std::size_t limit) -> void
+        {
+            if (count > limit)
+            {
+                throw LimitExceeded();
+            }
+        }
+
+        auto count_token() -> void
+        {
+            check(++m_tokens, m_limits.max_tokens);
+        }
+
+        Limits const& m_limits;
+        std::size_t m_tokens = 0;
+        std::size_t m_operations = 0;
+        std::size_t m_nesting = 0;
+    };
+}
+
+auto within_limits(std::string_view input, Limits const& limits) -> bool
+{
+    if (input.size() > limits.max_input_length)
+    {
+        return false;
+    }
+
+    LimitCounter counter(limits);
+    try
+    {
+        scan_tokens(input, counter);
+    }
+    catch (LimitExceeded&)
+    {
+        return false;
+    }
+    catch (InfixError&)
+    {
+        // The tokenizer stops at the same place when the input is evaluated, so what it
+        // counted so far is all the input can cost.
+    }
+
+    return true;
+}
+
+auto evaluate(std::string const& input, Limits const& limits) -> Result
+{
+    if (!within_limits(input, limits))
+    {
+        return {0, true, ErrorKind::limit};
+    }
+
+    return evaluate(input);
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <cfenv>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "batch.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+#include "strict.hpp"
+
+namespace
+{
+    constexpr std::size_t strict_block = 64;
+
+    auto set_valid(std::uint8_t* validity, std::size_t i, bool valid) -> void
+    {
+        auto bit = std::uint8_t(1U << (i % 8));
+        validity[i / 8] = valid ? validity[i / 8] | bit : validity[i / 8] & ~bit;
+    }
+
+    auto to_batch_error(ErrorKind kind) -> BatchError
+    {
+        switch (kind)
+        {
+        case ErrorKind::divide_by_zero:
+            return BatchError::divide_by_zero;
+        case ErrorKind::overflow:
+            return BatchError::overflow;
+        case ErrorKind::invalid_operation:
+            return BatchError::invalid_operation;
+        default:
+            return BatchError::syntax;
+        }
+    }
+
+    // Evaluates row i into the output columns. Returns whether it parsed.
+    auto evaluate_row(char const* data, std::size_t const* offsets, std::size_t i,
+        double* values, std::uint8_t* validity, BatchError* errors) -> bool
+    {
+        thread_local std::vector<symbol> infix;
+        thread_local std::vector<symbol> postfix;
+        thread_local std::vector<char> ops;
+
+        infix.clear();
+        postfix.clear();
+        ops.clear();
+
+        std::size_t max_depth = 0;
+        try
+        {
+            std::string_view input(data + offsets[i], offsets[i + 1] - offsets[i]);
+            scan_tokens(input, infix);
+            max_depth = infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+        }
+        catch (InfixError&)
+        {
+            values[i] = 0;
+            set_valid(validity, i, false);
+            errors[i] = BatchError::syntax;
+
+            return false;
+        }
+
+        values[i] = evaluate_postfix(postfix, max_depth);
+        set_valid(validity, i, true);
+        errors[i] = BatchError::none;
+
+        return true;
+    }
+}
+
+auto evaluate_batch(char const* data, std::size_t const* offsets, std::size_t count,
+    double* values, std::uint8_t* validity, BatchError* errors, bool strict) -> void
+{
+    std::fill(validity, validity + (count + 7) / 8, 0);
+
+    if (!strict)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            evaluate_row(data, offsets, i, values, validity, errors);
+        }
+
+        return;
+    }
+
+    ExceptionFlagsGuard guard;
+
+    for (std::size_t block = 0; block < count; block += strict_block)
+    {
+        std::size_t block_end = std::min(count, block + strict_block);
+
+        std::feclearexcept(FE_ALL_EXCEPT);
+        for (std::size_t i = block; i < block_end; i++)
+        {
+            evaluate_row(data, offsets, i, values, validity, errors);
+        }
+
+        if (std::fetestexcept(strict_exceptions) == 0)
+        {
+            continue;
+        }
+
+        for (std::size_t i = block; i < block_end; i++)
+        {
+            std::feclearexcept(FE_ALL_EXCEPT);
+
+            ErrorKind kind{};
+            if (evaluate_row(data, offsets, i, values, validity, errors)
+                && strict_error(std::fetestexcept(strict_exceptions), kind))
+            {
+                values[i] = 0;
+                set_valid(validity, i, false);
+                errors[i] = to_batch_error(kind);
+            }
+        }
+    }
+}
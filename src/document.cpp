@@ -0,0 +1,1141 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+
+// The items of a group are its tokens and nested groups, kept in chunks of about chunk_size
+// items. Offsets are relative to the chunk's base, and bases to the start of the group's
+// content, so an edit rewrites the chunks around it and only moves the bases of the others.
+//
+// A valid group alternates operands and operators, starting and ending with an operand. Its
+// value is folded left to right at both precedence levels, exactly as evaluate_postfix runs
+// its postfix program. Each chunk caches its terms with their products already folded, and
+// the fold state it starts from, so a group is refolded from the first chunk that changed and
+// only over the terms after it.
+struct DocumentGroup
+{
+    static constexpr std::size_t clean = std::numeric_limits<std::size_t>::max();
+
+    struct Item
+    {
+        // A number or a character. For a nested group, whose content starts at begin + 1 and
+        // ends at end - 1, a copy of the group's value, so a refold reads no group. A
+        // character that is not an operator (including an unmatched parenthesis) makes the
+        // group invalid, and so does a number that does not fit in a double.
+        symbol token;
+        std::unique_ptr<DocumentGroup> group;
+        std::size_t begin;
+        std::size_t end;
+        bool fits = true;
+    };
+
+    // The fold after some operand: the terms before its own folded with + and -, the operator
+    // that adds its term to them (0 for the first term), and its term so far. Between chunks,
+    // `carry` is the operator that ends the previous one, if any.
+    struct FoldState
+    {
+        double sum = 0;
+        char pending = 0;
+        double term = 0;
+        char carry = 0;
+    };
+
+    // An operand with the operator before it, or 0 if that operator ends the previous chunk.
+    // The * and / operands of a term that starts with + or - in the same chunk are folded
+    // into the step of its first operand.
+    struct Step
+    {
+        char op;
+        double value;
+    };
+
+    // A chunk's counts are those of its own items and the pairs among them; its group's
+    // counts add the pairs across chunk boundaries.
+    struct Chunk
+    {
+        std::vector<Item> items;
+        std::size_t base = 0;
+        std::size_t defects = 0;
+        std::size_t invalid_children = 0;
+        std::size_t strays = 0;
+
+        bool stale = true; // `steps` and `trailing` are out of date.
+        std::vector<Step> steps;
+        char trailing = 0; // The operator the chunk ends with, if any.
+        FoldState entry;
+    };
+
+    std::vector<Chunk> chunks; // Never holds an empty chunk.
+    std::size_t length = 0;
+
+    std::size_t defects = 0; // Bad items, plus pairs of neighbouring items of the same kind.
+    std::size_t invalid_children = 0;
+    std::size_t strays = 0; // Unmatched parentheses; only the root group keeps any.
+
+    std::size_t dirty = 0; // Chunks from this one on are folded again, unless clean.
+    bool valid = false;
+    double value = 0;
+
+    DocumentGroup() = default;
+    DocumentGroup(DocumentGroup const&) = delete;
+    auto operator=(DocumentGroup const&) -> DocumentGroup& = delete;
+
+    ~DocumentGroup();
+};
+
+// Nested groups are released from a worklist, not by recursion through their items, so a
+// document nested hundreds of thousands deep does not run out of stack when it goes away.
+DocumentGroup::~DocumentGroup()
+{
+    std::vector<std::unique_ptr<DocumentGroup>> pending;
+    auto take_children = [&pending](DocumentGroup& group) {
+        for (auto& chunk : group.chunks)
+        {
+            for (auto& item : chunk.items)
+            {
+                if (item.group)
+                {
+                    pending.push_back(std::move(item.group));
+                }
+            }
+        }
+    };
+
+    take_children(*this);
+    while (!pending.empty())
+    {
+        std::unique_ptr<DocumentGroup> group = std::move(pending.back());
+        pending.pop_back();
+        take_children(*group);
+    }
+}
+
+namespace
+{
+    using Item = DocumentGroup::Item;
+    using Chunk = DocumentGroup::Chunk;
+    using FoldState = DocumentGroup::FoldState;
+
+    constexpr std::size_t chunk_size = 128;
+
+    enum class Kind
+    {
+        operand,
+        op,
+        bad
+    };
+
+    auto kind_of(Item const& item) -> Kind
+    {
+        if (item.group || (is_number(item.token) && item.fits))
+        {
+            return Kind::operand;
+        }
+
+        if (!is_number(item.token) && is_operator(as_operator(item.token)))
+        {
+            return Kind::op;
+        }
+
+        return Kind::bad;
+    }
+
+    auto is_paren(Item const& item) -> bool
+    {
+        return !item.group && !is_number(item.token)
+            && (as_operator(item.token) == '(' || as_operator(item.token) == ')');
+    }
+
+    auto is_paren(Item const& item, char c) -> bool
+    {
+        return is_paren(item) && as_operator(item.token) == c;
+    }
+
+    struct Counts
+    {
+        std::size_t defects = 0;
+        std::size_t invalid_children = 0;
+        std::size_t strays = 0;
+    };
+
+    // What the items in [first, last) add to their group's counts, including the pairs they
+    // form with their neighbours. An empty range counts the pair around it.
+    auto counts_of(std::vector<Item> const& items, std::size_t first, std::size_t last)
+        -> Counts
+    {
+        Counts counts;
+
+        for (std::size_t i = first; i < last; i++)
+        {
+            counts.defects += kind_of(items[i]) == Kind::bad ? 1 : 0;
+            counts.invalid_children += items[i].group && !items[i].group->valid ? 1 : 0;
+            counts.strays += is_paren(items[i]) ? 1 : 0;
+        }
+
+        for (std::size_t i = first > 0 ? first - 1 : 0; i < last && i + 1 < items.size(); i++)
+        {
+            counts.defects += kind_of(items[i]) == kind_of(items[i + 1]) ? 1 : 0;
+        }
+
+        return counts;
+    }
+
+    auto count(Chunk& chunk) -> void
+    {
+        Counts counts = counts_of(chunk.items, 0, chunk.items.size());
+        chunk.defects = counts.defects;
+        chunk.invalid_children = counts.invalid_children;
+        chunk.strays = counts.strays;
+    }
+
+    // What the chunks in [first, last) add to their group's counts, like counts_of does for
+    // items, from the chunks' own counts.
+    auto counts_of(std::vector<Chunk> const& chunks, std::size_t first, std::size_t last)
+        -> Counts
+    {
+        Counts counts;
+
+        for (std::size_t c = first; c < last; c++)
+        {
+            counts.defects += chunks[c].defects;
+            counts.invalid_children += chunks[c].invalid_children;
+            counts.strays += chunks[c].strays;
+        }
+
+        for (std::size_t c = first > 0 ? first - 1 : 0; c < last && c + 1 < chunks.size(); c++)
+        {
+            bool same = kind_of(chunks[c].items.back()) == kind_of(chunks[c + 1].items.front());
+            counts.defects += same ? 1 : 0;
+        }
+
+        return counts;
+    }
+
+    // The counts wrap around when they go down, and back up when an edit is done.
+    auto add(DocumentGroup& group, Counts const& counts) -> void
+    {
+        group.defects += counts.defects;
+        group.invalid_children += counts.invalid_children;
+        group.strays += counts.strays;
+    }
+
+    auto subtract(DocumentGroup& group, Counts const& counts) -> void
+    {
+        group.defects -= counts.defects;
+        group.invalid_children -= counts.invalid_children;
+        group.strays -= counts.strays;
+    }
+
+    // The arithmetic of get_operator, through a switch: a refold runs it for every term after
+    // the edit.
+    auto apply(char op, double a, double b) -> double
+    {
+        switch (op)
+        {
+        case '+':
+            return a + b;
+        case '-':
+            return a - b;
+        case '*':
+            return a * b;
+        default:
+            return a / b;
+        }
+    }
+
+    auto combine(double sum, char pending, double term) -> double
+    {
+        return pending == 0 ? term : apply(pending, sum, term);
+    }
+
+    auto is_additive(char op) -> bool
+    {
+        return op == '+' || op == '-';
+    }
+
+    // Rebuilds the steps of a chunk of a valid group.
+    auto summarize(Chunk& chunk) -> void
+    {
+        auto& steps = chunk.steps;
+        steps.clear();
+        char op = 0;
+
+        for (auto const& item : chunk.items)
+        {
+            if (kind_of(item) != Kind::operand)
+            {
+                op = as_operator(item.token);
+                continue;
+            }
+
+            double value = as_number(item.token);
+            if ((op == '*' || op == '/') && !steps.empty() && is_additive(steps.back().op))
+            {
+                steps.back().value = apply(op, steps.back().value, value);
+            }
+            else
+            {
+                steps.push_back({op, value});
+            }
+
+            op = 0;
+        }
+
+        chunk.trailing = op;
+        chunk.stale = false;
+    }
+
+    auto replay(FoldState state, Chunk const& chunk) -> FoldState
+    {
+        for (auto const& step : chunk.steps)
+        {
+            char op = step.op != 0 ? step.op : state.carry;
+
+            if (op == 0)
+            {
+                state.term = step.value;
+            }
+            else if (!is_additive(op))
+            {
+                state.term = apply(op, state.term, step.value);
+            }
+            else
+            {
+                state.sum = combine(state.sum, state.pending, state.term);
+                state.pending = op;
+                state.term = step.value;
+            }
+        }
+
+        state.carry = chunk.trailing;
+
+        return state;
+    }
+
+    // Refolds a valid group from the chunk before its first dirty one, whose entry state is
+    // still up to date.
+    auto fold(DocumentGroup& group) -> void
+    {
+        std::size_t c = group.dirty > 0 ? group.dirty - 1 : 0;
+        FoldState state = group.chunks[c].entry;
+
+        for (; c < group.chunks.size(); c++)
+        {
+            Chunk& chunk = group.chunks[c];
+            if (chunk.stale)
+            {
+                summarize(chunk);
+            }
+
+            chunk.entry = state;
+            state = replay(state, chunk);
+        }
+
+        group.value = combine(state.sum, state.pending, state.term);
+    }
+
+    // Updates a group's validity from its counts and, when it is valid, its value.
+    auto refresh(DocumentGroup& group) -> void
+    {
+        group.valid = !group.chunks.empty() && group.defects == 0 && group.invalid_children == 0
+            && kind_of(group.chunks.front().items.front()) == Kind::operand
+            && kind_of(group.chunks.back().items.back()) == Kind::operand;
+
+        if (group.valid && group.dirty != DocumentGroup::clean)
+        {
+            fold(group);
+            group.dirty = DocumentGroup::clean;
+        }
+    }
+
+    auto shift(std::vector<Item>& items, std::size_t first, std::size_t delta) -> void
+    {
+        for (std::size_t i = first; i < items.size(); i++)
+        {
+            items[i].begin += delta;
+            items[i].end += delta;
+        }
+    }
+
+    // Splits items, with offsets relative to their group, into chunks of about chunk_size.
+    auto split(std::vector<Item>& items) -> std::vector<Chunk>
+    {
+        std::vector<Chunk> chunks((items.size() + chunk_size - 1) / chunk_size);
+
+        for (std::size_t c = 0; c < chunks.size(); c++)
+        {
+            std::size_t first = c * items.size() / chunks.size();
+            std::size_t last = (c + 1) * items.size() / chunks.size();
+            Chunk& chunk = chunks[c];
+
+            chunk.base = items[first].begin;
+            chunk.items.reserve(last - first);
+            for (std::size_t i = first; i < last; i++)
+            {
+                items[i].begin -= chunk.base;
+                items[i].end -= chunk.base;
+                chunk.items.push_back(std::move(items[i]));
+            }
+            count(chunk);
+        }
+
+        return chunks;
+    }
+
+    // Moves the items of a chunk into `out` at `at`, with offsets relative to the group, and
+    // returns how many there were.
+    auto unpack(Chunk& chunk, std::vector<Item>& out, std::size_t at) -> std::size_t
+    {
+        shift(chunk.items, 0, chunk.base);
+        out.insert(out.begin() + std::ptrdiff_t(at),
+            std::make_move_iterator(chunk.items.begin()),
+            std::make_move_iterator(chunk.items.end()));
+
+        return chunk.items.size();
+    }
+
+    // Replaces all items of a group, counting them again.
+    auto assign(DocumentGroup& group, std::vector<Item>& items) -> void
+    {
+        Counts counts = counts_of(items, 0, items.size());
+        group.defects = counts.defects;
+        group.invalid_children = counts.invalid_children;
+        group.strays = counts.strays;
+
+        group.chunks = split(items);
+        group.dirty = 0;
+    }
+
+    struct Position
+    {
+        std::size_t chunk;
+        std::size_t index;
+    };
+
+    // The items of a run of a group's chunks, unpacked with offsets relative to the group so
+    // that ranges of them can be replaced, and packed into new chunks by commit(). The group's
+    // counts are kept up to date, which needs the items on either side of a replaced range:
+    // the window starts with one more chunk on either side, and can grow.
+    class Window
+    {
+    public:
+        Window(DocumentGroup& _group, std::size_t _first_chunk, std::size_t _last_chunk)
+            : m_group(_group),
+              m_first(_first_chunk > 0 ? _first_chunk - 1 : 0),
+              m_last(std::min(_last_chunk + 2, _group.chunks.size()))
+        {
+            for (std::size_t c = m_first; c < m_last; c++)
+            {
+                m_starts.push_back(m_items.size());
+                unpack(m_group.chunks[c], m_items, m_items.size());
+            }
+        }
+
+        auto items() -> std::vector<Item>&
+        {
+            return m_items;
+        }
+
+        // Index of the item at `at`, which is in the window or at the end of the group.
+        auto index_of(Position at) const -> std::size_t
+        {
+            return at.chunk < m_last ? m_starts[at.chunk - m_first] + at.index : m_items.size();
+        }
+
+        auto can_grow_left() const -> bool
+        {
+            return m_first > 0;
+        }
+
+        auto can_grow_right() const -> bool
+        {
+            return m_last < m_group.chunks.size();
+        }
+
+        // Unpacks the chunk before the window and returns by how much the indices moved.
+        auto grow_left() -> std::size_t
+        {
+            std::size_t added = unpack(m_group.chunks[--m_first], m_items, 0);
+            for (auto& start : m_starts)
+            {
+                start += added;
+            }
+            m_starts.insert(m_starts.begin(), 0);
+
+            return added;
+        }
+
+        auto grow_right() -> void
+        {
+            m_starts.push_back(m_items.size());
+            unpack(m_group.chunks[m_last++], m_items, m_items.size());
+        }
+
+        auto remove(std::size_t first, std::size_t last) -> std::vector<Item>
+        {
+            subtract(counts_of(m_items, first, last));
+            std::vector<Item> removed(
+                std::make_move_iterator(m_items.begin() + std::ptrdiff_t(first)),
+                std::make_move_iterator(m_items.begin() + std::ptrdiff_t(last)));
+            m_items.erase(m_items.begin() + std::ptrdiff_t(first),
+                m_items.begin() + std::ptrdiff_t(last));
+            add(counts_of(m_items, first, first));
+
+            return removed;
+        }
+
+        auto insert(std::size_t at, std::vector<Item>& items) -> void
+        {
+            subtract(counts_of(m_items, at, at));
+            m_items.insert(m_items.begin() + std::ptrdiff_t(at),
+                std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+            add(counts_of(m_items, at, at + items.size()));
+        }
+
+        // Moves the items from `first` on, and those after the window, by `delta`.
+        auto shift_from(std::size_t first, std::size_t delta) -> void
+        {
+            shift(m_items, first, delta);
+            m_delta += delta;
+        }
+
+        auto commit() -> void
+        {
+            auto& chunks = m_group.chunks;
+            for (std::size_t c = m_last; c < chunks.size(); c++)
+            {
+                chunks[c].base += m_delta;
+            }
+
+            std::vector<Chunk> packed = split(m_items);
+            auto at = chunks.erase(chunks.begin() + std::ptrdiff_t(m_first),
+                chunks.begin() + std::ptrdiff_t(m_last));
+            chunks.insert(at, std::make_move_iterator(packed.begin()),
+                std::make_move_iterator(packed.end()));
+
+            m_group.dirty = std::min(m_group.dirty, m_first);
+        }
+
+    private:
+        auto add(Counts const& counts) -> void
+        {
+            ::add(m_group, counts);
+        }
+
+        auto subtract(Counts const& counts) -> void
+        {
+            ::subtract(m_group, counts);
+        }
+
+        DocumentGroup& m_group;
+        std::size_t m_first;
+        std::size_t m_last;
+        std::vector<Item> m_items;
+        std::vector<std::size_t> m_starts; // Index in m_items of each chunk's first item.
+        std::size_t m_delta = 0;
+    };
+
+    // Tokenizes text[begin, end), with parentheses as tokens of their own, appending items
+    // with offsets relative to `base`. Before each token, `stop(pos)` may end the scan early.
+    // Returns where the scan ended.
+    template<typename Stop>
+    auto scan_items(std::string const& text, std::size_t base, std::size_t begin,
+        std::size_t end, std::vector<Item>& out, Stop stop) -> std::size_t
+    {
+        char const* const data = text.data();
+        std::size_t pos = begin;
+
+        while (true)
+        {
+            while (pos < end && is_space(data[pos]))
+            {
+                pos++;
+            }
+
+            if (pos >= end || stop(pos))
+            {
+                return pos;
+            }
+
+            Item item{0.0, nullptr, pos - base, 0};
+            pos = std::size_t(scan_token(data + pos, data + end, item.token, item.fits) - data);
+            item.end = pos - base;
+            out.push_back(std::move(item));
+        }
+    }
+
+    // The first item of a group that ends after `pos`, or the end of its chunks.
+    auto first_ending_after(DocumentGroup const& group, std::size_t pos) -> Position
+    {
+        auto const& chunks = group.chunks;
+        auto c = std::partition_point(chunks.begin(), chunks.end(),
+            [pos](Chunk const& chunk) { return chunk.base + chunk.items.back().end <= pos; });
+        if (c == chunks.end())
+        {
+            return {chunks.size(), 0};
+        }
+
+        auto i = std::partition_point(c->items.begin(), c->items.end(),
+            [pos, c](Item const& item) { return c->base + item.end <= pos; });
+
+        return {std::size_t(c - chunks.begin()), std::size_t(i - c->items.begin())};
+    }
+
+    // Splits a chunk before the item at `at` and returns the index of the chunk that starts
+    // with it, or of the next chunk if `at` is past the chunk's items.
+    auto cut(DocumentGroup& group, Position at) -> std::size_t
+    {
+        auto& chunks = group.chunks;
+        if (at.index == 0 || at.index == chunks[at.chunk].items.size())
+        {
+            return at.index == 0 ? at.chunk : at.chunk + 1;
+        }
+
+        Chunk& head = chunks[at.chunk];
+        Chunk tail;
+        tail.base = head.base + head.items[at.index].begin;
+        auto moved = head.items.begin() + std::ptrdiff_t(at.index);
+        tail.items.assign(
+            std::make_move_iterator(moved), std::make_move_iterator(head.items.end()));
+        head.items.resize(at.index);
+        shift(tail.items, 0, head.base - tail.base);
+        count(head);
+        count(tail);
+        head.stale = true;
+
+        chunks.insert(chunks.begin() + std::ptrdiff_t(at.chunk + 1), std::move(tail));
+        group.dirty = std::min(group.dirty, at.chunk);
+
+        return at.chunk + 1;
+    }
+
+    // Merges chunk `c` into the one before it, if they fit in one.
+    auto coalesce(DocumentGroup& group, std::size_t c) -> void
+    {
+        auto& chunks = group.chunks;
+        if (c == 0 || c >= chunks.size()
+            || chunks[c - 1].items.size() + chunks[c].items.size() > chunk_size)
+        {
+            return;
+        }
+
+        Chunk& head = chunks[c - 1];
+        Chunk& tail = chunks[c];
+        shift(tail.items, 0, tail.base - head.base);
+        head.items.insert(head.items.end(), std::make_move_iterator(tail.items.begin()),
+            std::make_move_iterator(tail.items.end()));
+        count(head);
+        head.stale = true;
+
+        chunks.erase(chunks.begin() + std::ptrdiff_t(c));
+        group.dirty = std::min(group.dirty, c - 1);
+    }
+
+    auto rematch(DocumentGroup& group, std::vector<Item> items) -> void;
+
+    // Turns a matched pair of parentheses, the first and last of `pair`, and the items between
+    // them into a nested group.
+    auto nest(std::vector<Item>& pair) -> Item
+    {
+        auto child = std::make_unique<DocumentGroup>();
+        std::size_t content = pair.front().end;
+        child->length = pair.back().begin - content;
+
+        std::vector<Item> inner(std::make_move_iterator(pair.begin() + 1),
+            std::make_move_iterator(pair.end() - 1));
+        shift(inner, 0, std::size_t{0} - content);
+        rematch(*child, std::move(inner));
+        refresh(*child);
+
+        double value = child->value;
+
+        return {value, std::move(child), pair.front().begin, pair.back().end};
+    }
+
+    // Pairs up the unmatched parentheses of `items`: each pair and the items between them
+    // become a nested group. Parentheses left unmatched stay strays.
+    auto pair_up(std::vector<Item>& items) -> std::vector<Item>
+    {
+        std::vector<Item> out;
+        out.reserve(items.size());
+        std::vector<std::size_t> opens;
+
+        for (auto& item : items)
+        {
+            if (!is_paren(item, ')') || opens.empty())
+            {
+                if (is_paren(item, '('))
+                {
+                    opens.push_back(out.size());
+                }
+
+                out.push_back(std::move(item));
+                continue;
+            }
+
+            std::size_t open = opens.back();
+            opens.pop_back();
+
+            std::vector<Item> pair(std::make_move_iterator(out.begin() + std::ptrdiff_t(open)),
+                std::make_move_iterator(out.end()));
+            pair.push_back(std::move(item));
+            out.resize(open);
+            out.push_back(nest(pair));
+        }
+
+        return out;
+    }
+
+    // Sets a group's items, first pairing up their unmatched parentheses.
+    auto rematch(DocumentGroup& group, std::vector<Item> items) -> void
+    {
+        std::vector<Item> out = pair_up(items);
+        assign(group, out);
+    }
+
+    // Turns the strays of a group at `open` and `close`, which match, and the items between
+    // them into a nested group. The chunks between them are moved into it whole.
+    auto nest(DocumentGroup& group, std::size_t open, std::size_t close) -> void
+    {
+        auto& chunks = group.chunks;
+
+        // `first` is the chunk after the one that ends with the opening parenthesis, `last`
+        // the one that holds only the closing one.
+        Position at = first_ending_after(group, close);
+        cut(group, {at.chunk, at.index + 1});
+        std::size_t last = cut(group, at);
+        at = first_ending_after(group, open);
+        std::size_t before = chunks.size();
+        std::size_t first = cut(group, {at.chunk, at.index + 1});
+        last += chunks.size() - before;
+        subtract(group, counts_of(chunks, first - 1, last + 1));
+
+        auto child = std::make_unique<DocumentGroup>();
+        std::size_t content = open + 1;
+        child->length = close - content;
+        child->chunks.assign(std::make_move_iterator(chunks.begin() + std::ptrdiff_t(first)),
+            std::make_move_iterator(chunks.begin() + std::ptrdiff_t(last)));
+        for (auto& chunk : child->chunks)
+        {
+            chunk.base -= content;
+        }
+        if (!child->chunks.empty())
+        {
+            child->chunks.front().entry = FoldState{};
+        }
+        add(*child, counts_of(child->chunks, 0, child->chunks.size()));
+        coalesce(*child, child->chunks.size() - 1);
+        coalesce(*child, 1);
+        refresh(*child);
+
+        Chunk& left = chunks[first - 1];
+        double value = child->value;
+        left.items.back() = {value, std::move(child), open - left.base, close + 1 - left.base};
+        count(left);
+        left.stale = true;
+        chunks.erase(chunks.begin() + std::ptrdiff_t(first),
+            chunks.begin() + std::ptrdiff_t(last + 1));
+        add(group, counts_of(chunks, first - 1, first));
+
+        group.dirty = std::min(group.dirty, first - 1);
+        coalesce(group, first);
+        coalesce(group, first - 1);
+    }
+
+    // Pairs up the strays of a group that match now. With few pairs, each is nested by moving
+    // chunks; with many, the chunks from the first pair to the last are unpacked and paired
+    // up in one pass.
+    auto rematch_strays(DocumentGroup& group) -> void
+    {
+        std::vector<Position> strays;
+        std::vector<std::size_t> offsets;
+        for (std::size_t c = 0; c < group.chunks.size(); c++)
+        {
+            Chunk const& chunk = group.chunks[c];
+            for (std::size_t i = 0; chunk.strays > 0 && i < chunk.items.size(); i++)
+            {
+                if (is_paren(chunk.items[i]))
+                {
+                    strays.push_back({c, i});
+                    offsets.push_back(chunk.base + chunk.items[i].begin);
+                }
+            }
+        }
+
+        // Pairs of indices in `strays`, found the way pair_up finds them: inner ones first.
+        std::vector<std::pair<std::size_t, std::size_t>> pairs;
+        std::vector<std::size_t> opens;
+        for (std::size_t k = 0; k < strays.size(); k++)
+        {
+            Item const& item = group.chunks[strays[k].chunk].items[strays[k].index];
+            if (is_paren(item, '('))
+            {
+                opens.push_back(k);
+            }
+            else if (!opens.empty())
+            {
+                pairs.emplace_back(opens.back(), k);
+                opens.pop_back();
+            }
+        }
+
+        if (pairs.empty())
+        {
+            return;
+        }
+
+        std::size_t first = pairs.front().first;
+        std::size_t last = pairs.front().second;
+        for (auto const& [open, close] : pairs)
+        {
+            first = std::min(first, open);
+            last = std::max(last, close);
+        }
+
+        std::size_t spanned = strays[last].chunk - strays[first].chunk + 1;
+        if (pairs.size() * group.chunks.size() < spanned * chunk_size)
+        {
+            for (auto const& [open, close] : pairs)
+            {
+                nest(group, offsets[open], offsets[close]);
+            }
+
+            return;
+        }
+
+        Window window(group, strays[first].chunk, strays[last].chunk);
+        std::size_t begin = window.index_of(strays[first]);
+        std::vector<Item> items = window.remove(begin, window.index_of(strays[last]) + 1);
+        std::vector<Item> paired = pair_up(items);
+        window.insert(begin, paired);
+        window.commit();
+    }
+
+    // Replaces the nested group at `begin` with its parentheses and items, moving its chunks
+    // into the group whole.
+    auto dissolve(DocumentGroup& group, std::size_t begin) -> void
+    {
+        auto& chunks = group.chunks;
+        Position at = first_ending_after(group, begin);
+        cut(group, {at.chunk, at.index + 1});
+        std::size_t c = cut(group, at);
+        subtract(group, counts_of(chunks, c, c + 1));
+
+        Item outer = std::move(chunks[c].items.front());
+        std::size_t end = chunks[c].base + outer.end;
+
+        std::vector<Chunk> parts(1);
+        parts.front().base = begin;
+        parts.front().items.push_back(Item{'(', nullptr, 0, 1});
+        for (auto& chunk : outer.group->chunks)
+        {
+            chunk.base += begin + 1;
+            parts.push_back(std::move(chunk));
+        }
+        parts.emplace_back();
+        parts.back().base = end - 1;
+        parts.back().items.push_back(Item{')', nullptr, 0, 1});
+        count(parts.front());
+        count(parts.back());
+
+        std::size_t added = parts.size();
+        chunks.erase(chunks.begin() + std::ptrdiff_t(c));
+        chunks.insert(chunks.begin() + std::ptrdiff_t(c),
+            std::make_move_iterator(parts.begin()), std::make_move_iterator(parts.end()));
+        add(group, counts_of(chunks, c, c + added));
+        group.dirty = std::min(group.dirty, c);
+
+        // From the right, so the seams still to go stay put.
+        coalesce(group, c + added);
+        coalesce(group, c + added - 1);
+        coalesce(group, c + 1);
+        coalesce(group, c);
+    }
+}
+
+Document::Document(std::string text)
+    : m_text(std::move(text))
+{
+    reparse_all();
+}
+
+Document::Document(Document&&) noexcept = default;
+auto Document::operator=(Document&&) noexcept -> Document& = default;
+Document::~Document() = default;
+
+auto Document::reparse_all() -> void
+{
+    std::vector<Item> items;
+    scan_items(m_text, 0, 0, m_text.size(), items, [](std::size_t) { return false; });
+
+    m_root = std::make_unique<DocumentGroup>();
+    m_root->length = m_text.size();
+    rematch(*m_root, std::move(items));
+    refresh(*m_root);
+
+    m_result = m_root->valid ? Result{m_root->value, false} : Result{0, true};
+}
+
+auto Document::edit(std::size_t offset, std::size_t removed, std::string_view inserted)
+    -> Result
+{
+    if (offset > m_text.size())
+    {
+        throw std::out_of_range("Document::edit offset past the end");
+    }
+
+    removed = std::min(removed, m_text.size() - offset);
+    m_text.replace(offset, removed, inserted);
+
+    // Lengths and offsets wrap around on purpose when the edit shrinks the text.
+    std::size_t delta = inserted.size() - removed;
+
+    // Innermost group whose content holds the whole edited range, with the groups above it.
+    struct Step
+    {
+        DocumentGroup* group;
+        std::size_t begin; // Absolute start of the group's content.
+        Position at;       // Of this group in its parent.
+    };
+
+    std::vector<Step> path{{m_root.get(), 0, {0, 0}}};
+    while (true)
+    {
+        DocumentGroup const& group = *path.back().group;
+        std::size_t begin = path.back().begin;
+        std::size_t lo = offset - begin;
+
+        Position at = first_ending_after(group, lo);
+        if (at.chunk == group.chunks.size())
+        {
+            break;
+        }
+
+        Chunk const& chunk = group.chunks[at.chunk];
+        Item const& item = chunk.items[at.index];
+        if (!item.group || lo < chunk.base + item.begin + 1
+            || lo + removed > chunk.base + item.end - 1)
+        {
+            break;
+        }
+
+        path.push_back({item.group.get(), begin + chunk.base + item.begin + 1, at});
+    }
+
+    DocumentGroup& group = *path.back().group;
+    std::size_t base = path.back().begin;
+    std::size_t lo = offset - base;
+    std::size_t inserted_end = lo + inserted.size();
+
+    // A removal that takes one parenthesis of a nested group would rescan all of its text:
+    // the group is dissolved first, which moves its chunks, and matched again below.
+    bool structural = false;
+    while (removed > 0)
+    {
+        std::size_t hi = lo + removed;
+        auto straddles = [&group, lo, hi](Position p) {
+            if (p.chunk == group.chunks.size())
+            {
+                return false;
+            }
+
+            Chunk const& chunk = group.chunks[p.chunk];
+            Item const& item = chunk.items[p.index];
+            std::size_t b = chunk.base + item.begin;
+            std::size_t e = chunk.base + item.end;
+
+            return item.group && b < hi && (b < lo || e > hi);
+        };
+
+        Position p = first_ending_after(group, lo);
+        if (!straddles(p))
+        {
+            p = first_ending_after(group, hi - 1);
+            if (!straddles(p))
+            {
+                break;
+            }
+        }
+
+        Chunk const& chunk = group.chunks[p.chunk];
+        dissolve(group, chunk.base + chunk.items[p.index].begin);
+        structural = true;
+    }
+
+    Position at = first_ending_after(group, lo);
+    Window window(group, at.chunk, at.chunk);
+    std::vector<Item>& items = window.items();
+
+    // Rescans from the first token the edit can change: one it touches, or a number up to
+    // two bytes before it, as from_chars looks that far ahead for an exponent.
+    std::size_t first = window.index_of(at);
+    while (true)
+    {
+        if (first == 0 && window.can_grow_left())
+        {
+            first += window.grow_left();
+        }
+
+        if (first == 0 || items[first - 1].group || items[first - 1].end + 2 < lo)
+        {
+            break;
+        }
+
+        first--;
+    }
+
+    std::size_t scan_begin = first < items.size() ? std::min(items[first].begin, lo) : lo;
+    std::size_t scan_end = group.length + delta;
+
+    // Once past the edit, the scan stops at the start of an old token: the tokens from there
+    // on are unchanged, and so are their items.
+    std::size_t last = first;
+    std::vector<Item> fresh;
+    std::size_t stopped = scan_items(m_text, base, base + scan_begin, base + scan_end, fresh,
+        [&](std::size_t pos) {
+            if (pos - base < inserted_end)
+            {
+                return false;
+            }
+
+            std::size_t old_pos = pos - base - delta;
+            while (true)
+            {
+                if (last == items.size() && window.can_grow_right())
+                {
+                    window.grow_right();
+                }
+
+                if (last == items.size() || items[last].begin >= old_pos)
+                {
+                    break;
+                }
+
+                last++;
+            }
+
+            return last < items.size() && items[last].begin == old_pos;
+        });
+
+    if (stopped >= base + scan_end)
+    {
+        while (window.can_grow_right())
+        {
+            window.grow_right();
+        }
+
+        last = items.size();
+    }
+
+    if (last == items.size() && window.can_grow_right())
+    {
+        window.grow_right();
+    }
+
+    structural = structural || std::any_of(fresh.begin(), fresh.end(),
+        [](Item const& item) { return is_paren(item); });
+    for (std::size_t i = first; i < last; i++)
+    {
+        structural = structural || items[i].group || is_paren(items[i]);
+    }
+
+    window.remove(first, last);
+    window.insert(first, fresh);
+    window.shift_from(first + fresh.size(), delta);
+    window.commit();
+    group.length += delta;
+
+    for (std::size_t j = path.size() - 1; j-- > 0;)
+    {
+        DocumentGroup& parent = *path[j].group;
+        Position child = path[j + 1].at;
+        Chunk& chunk = parent.chunks[child.chunk];
+
+        chunk.items[child.index].end += delta;
+        shift(chunk.items, child.index + 1, delta);
+        for (std::size_t c = child.chunk + 1; c < parent.chunks.size(); c++)
+        {
+            parent.chunks[c].base += delta;
+        }
+        parent.length += delta;
+    }
+
+    // Added or removed parentheses can change which ones match. Only the root keeps strays.
+    // Those left in a nested group are closing ones, then opening ones, and each enclosing
+    // group matches one of either: the groups up to where both kinds run out, or up to the
+    // root if one outnumbers the other, are dissolved into the one above them at once.
+    std::size_t level = path.size() - 1;
+    if (structural && group.strays > 0)
+    {
+        rematch_strays(group);
+    }
+
+    if (level > 0 && group.strays > 0)
+    {
+        std::size_t closes = 0;
+        for (auto const& chunk : group.chunks)
+        {
+            for (std::size_t i = 0; chunk.strays > 0 && i < chunk.items.size(); i++)
+            {
+                closes += is_paren(chunk.items[i], ')') ? 1 : 0;
+            }
+        }
+
+        std::size_t opens = group.strays - closes;
+        std::size_t top = closes == opens ? level - std::min(closes, level) : 0;
+        for (std::size_t j = top + 1; j <= level; j++)
+        {
+            dissolve(*path[top].group, path[j].begin - 1 - path[top].begin);
+        }
+
+        level = top;
+        rematch_strays(*path[level].group);
+    }
+
+    for (std::size_t j = level;; j--)
+    {
+        DocumentGroup& current = *path[j].group;
+        bool was_valid = current.valid;
+        double old_value = current.value;
+        refresh(current);
+
+        if (j == 0)
+        {
+            break;
+        }
+
+        DocumentGroup& parent = *path[j - 1].group;
+        Chunk& chunk = parent.chunks[path[j].at.chunk];
+        if (current.valid && !was_valid)
+        {
+            parent.invalid_children--;
+            chunk.invalid_children--;
+        }
+        else if (!current.valid && was_valid)
+        {
+            parent.invalid_children++;
+            chunk.invalid_children++;
+        }
+
+        if (current.valid != was_valid || current.value != old_value)
+        {
+            chunk.items[path[j].at.index].token = current.value;
+            chunk.stale = true;
+            parent.dirty = std::min(parent.dirty, path[j].at.chunk);
+        }
+    }
+
+    m_result = m_root->valid ? Result{m_root->value, false} : Result{0, true};
+
+    return m_result;
+}
@@ -0,0 +1,112 @@
+#include <array>
+#include <cstddef>
+#include <variant>
+#include <vector>
+
+#include "flat.hpp"
+#include "solution.hpp"
+
+FlatProgram::FlatProgram(std::vector<symbol> const& postfix, std::size_t max_depth)
+    : m_max_depth(max_depth)
+{
+    m_code.reserve(postfix.size());
+
+    for (auto const& s : postfix)
+    {
+        if (is_number(s))
+        {
+            m_code.push_back({Code::push, as_number(s)});
+            continue;
+        }
+
+        // The instruction before an operator produces its right operand, so "push b; op"
+        // becomes "op_imm b".
+        bool fuse = !m_code.empty() && m_code.back().code == Code::push;
+
+        Code code = Code::add;
+        switch (as_operator(s))
+        {
+        case '+':
+            code = fuse ? Code::add_imm : Code::add;
+            break;
+        case '-':
+            code = fuse ? Code::sub_imm : Code::sub;
+            break;
+        case '*':
+            code = fuse ? Code::mul_imm : Code::mul;
+            break;
+        default:
+            code = fuse ? Code::div_imm : Code::div;
+            break;
+        }
+
+        if (fuse)
+        {
+            m_code.back().code = code;
+        }
+        else
+        {
+            m_code.push_back({code, 0});
+        }
+    }
+}
+
+auto FlatProgram::run() const -> double
+{
+    constexpr std::size_t local_capacity = 64;
+
+    std::array<double, local_capacity> local_stack;
+    thread_local std::vector<double> shared_stack;
+
+    double* stack = local_stack.data();
+    if (m_max_depth > local_capacity)
+    {
+        if (shared_stack.size() < m_max_depth)
+        {
+            shared_stack.resize(m_max_depth);
+        }
+
+        stack = shared_stack.data();
+    }
+
+    double* top = stack;
+    for (auto const& ins : m_code)
+    {
+        switch (ins.code)
+        {
+        case Code::push:
+            *top++ = ins.imm;
+            break;
+        case Code::add:
+            top--;
+            top[-1] = top[-1] + *top;
+            break;
+        case Code::sub:
+            top--;
+            top[-1] = top[-1] - *top;
+            break;
+        case Code::mul:
+            top--;
+            top[-1] = top[-1] * *top;
+            break;
+        case Code::div:
+            top--;
+            top[-1] = top[-1] / *top;
+            break;
+        case Code::add_imm:
+            top[-1] = top[-1] + ins.imm;
+            break;
+        case Code::sub_imm:
+            top[-1] = top[-1] - ins.imm;
+            break;
+        case Code::mul_imm:
+            top[-1] = top[-1] * ins.imm;
+            break;
+        case Code::div_imm:
+            top[-1] = top[-1] / ins.imm;
+            break;
+        }
+    }
+
+    return stack[0];
+}
@@ -0,0 +1,134 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "fused.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+
+namespace
+{
+    struct NodeKey
+    {
+        char op;
+        std::uint64_t a;
+        std::uint64_t b;
+
+        auto operator==(NodeKey const& other) const -> bool
+        {
+            return op == other.op && a == other.a && b == other.b;
+        }
+    };
+
+    struct NodeKeyHash
+    {
+        auto operator()(NodeKey const& key) const -> std::size_t
+        {
+            std::uint64_t h = key.a * 0x9e3779b97f4a7c15ULL;
+            h ^= (key.b + 0x632be59bd9b4e019ULL + (h << 6) + (h >> 2)) * 0xff51afd7ed558ccdULL;
+
+            return std::size_t(h ^ std::uint64_t(key.op) ^ (h >> 32));
+        }
+    };
+
+    auto bits_of(double d) -> std::uint64_t
+    {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &d, sizeof bits);
+
+        return bits;
+    }
+}
+
+FusedProgram::FusedProgram(std::vector<std::string> const& inputs)
+{
+    std::unordered_map<NodeKey, std::size_t, NodeKeyHash> interned;
+
+    // Constants are keyed by their bit pattern, so 0 and -0 stay distinct.
+    auto intern = [this, &interned](NodeKey const& key, Node const& node) {
+        auto [it, inserted] = interned.try_emplace(key, m_nodes.size());
+        if (inserted)
+        {
+            m_nodes.push_back(node);
+        }
+
+        return it->second;
+    };
+
+    std::vector<symbol> infix;
+    std::vector<symbol> postfix;
+    std::vector<char> ops;
+    std::vector<std::size_t> values;
+
+    m_outputs.reserve(inputs.size());
+    for (auto const& input : inputs)
+    {
+        infix.clear();
+        postfix.clear();
+        ops.clear();
+        values.clear();
+
+        try
+        {
+            scan_tokens(input, infix);
+            infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+        }
+        catch (InfixError&)
+        {
+            m_outputs.push_back(no_node);
+            continue;
+        }
+
+        for (auto const& s : postfix)
+        {
+            if (auto const* d = std::get_if<double>(&s))
+            {
+                values.push_back(intern({0, bits_of(*d), 0}, {0, *d, no_node, no_node}));
+            }
+            else
+            {
+                char op = std::get<char>(s);
+                std::size_t right = values.back();
+                values.pop_back();
+                std::size_t left = values.back();
+                values.pop_back();
+
+                values.push_back(intern({op, left, right}, {op, 0, left, right}));
+            }
+        }
+
+        m_outputs.push_back(values.back());
+    }
+}
+
+auto FusedProgram::evaluate(Result* out) const -> void
+{
+    thread_local std::vector<double> registers;
+    registers.resize(m_nodes.size());
+
+    for (std::size_t i = 0; i < m_nodes.size(); i++)
+    {
+        Node const& node = m_nodes[i];
+
+        registers[i] = node.op == 0
+            ? node.value
+            : get_operator(node.op).fn(registers[node.left], registers[node.right]);
+    }
+
+    for (auto node : m_outputs)
+    {
+        *out++ = node == no_node ? Result{0, true} : Result{registers[node], false};
+    }
+}
+
+auto FusedProgram::evaluate() const -> std::vector<Result>
+{
+    std::vector<Result> results(m_outputs.size());
+    evaluate(results.data());
+
+    return results;
+}
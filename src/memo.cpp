@@ -0,0 +1,277 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "memo.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+
+struct MemoStore::Header
+{
+    std::uint64_t magic;
+    std::uint64_t version;
+    std::uint64_t capacity;
+    std::uint64_t count;
+    std::uint64_t reserved[4];
+};
+
+// A slot is empty while its hash is 0. Entries are only ever added, never changed.
+struct MemoStore::Slot
+{
+    std::uint64_t hash;
+    std::uint64_t check;
+    double value;
+    std::uint8_t error;
+    std::uint8_t kind;
+    std::uint8_t reserved[6];
+};
+
+namespace
+{
+    constexpr std::uint64_t store_magic = 0x4f4d454d4c415645; // "EVALMEMO"
+    constexpr std::uint64_t store_version = 1;
+
+    // Keeps the load factor at 3/4 so probes stay short and always reach an empty slot.
+    auto room_for(std::uint64_t slots) -> std::uint64_t
+    {
+        return slots / 4 * 3;
+    }
+
+    auto mix(std::uint64_t h) -> std::uint64_t
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+
+        return h;
+    }
+
+    auto word_of(symbol const& s) -> std::uint64_t
+    {
+        if (auto const* d = std::get_if<double>(&s))
+        {
+            std::uint64_t bits = 0;
+            std::memcpy(&bits, d, sizeof bits);
+
+            return bits;
+        }
+
+        return 0xfffc'0000'0000'0000 | static_cast<unsigned char>(std::get<char>(s));
+    }
+
+    auto fail(std::string const& path, char const* what) -> std::runtime_error
+    {
+        return std::runtime_error("MemoStore " + path + ": " + what);
+    }
+}
+
+auto memo_key(std::vector<symbol> const& tokens) -> MemoKey
+{
+    MemoKey key{0x9e3779b97f4a7c15ULL, 0x2545f4914f6cdd1dULL};
+
+    for (auto const& s : tokens)
+    {
+        std::uint64_t word = word_of(s);
+        key.hash = mix(key.hash ^ word);
+        key.check = mix(key.check + word * 0x9e3779b97f4a7c15ULL);
+    }
+
+    key.hash = mix(key.hash ^ tokens.size());
+    if (key.hash == 0)
+    {
+        key.hash = 1;
+    }
+
+    return key;
+}
+
+MemoStore::MemoStore(std::string const& path, bool writable, std::size_t capacity)
+    : m_writable(writable)
+{
+    m_fd = ::open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (m_fd < 0)
+    {
+        throw fail(path, "cannot open");
+    }
+
+    if (writable && ::flock(m_fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        ::close(m_fd);
+        throw fail(path, "already open for writing");
+    }
+
+    struct stat st = {};
+    ::fstat(m_fd, &st);
+
+    if (st.st_size == 0 && writable)
+    {
+        std::size_t slots = 16;
+        while (room_for(slots) < capacity)
+        {
+            slots *= 2;
+        }
+
+        Header header{store_magic, store_version, slots, 0, {}};
+        st.st_size = off_t(sizeof(Header) + slots * sizeof(Slot));
+        if (::ftruncate(m_fd, st.st_size) != 0
+            || ::pwrite(m_fd, &header, sizeof header, 0) != ssize_t(sizeof header))
+        {
+            ::close(m_fd);
+            throw fail(path, "cannot create");
+        }
+    }
+
+    m_map_size = std::size_t(st.st_size);
+    if (m_map_size >= sizeof(Header))
+    {
+        m_map = ::mmap(nullptr, m_map_size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+            MAP_SHARED, m_fd, 0);
+    }
+
+    if (m_map == nullptr || m_map == MAP_FAILED)
+    {
+        ::close(m_fd);
+        throw fail(path, "cannot map");
+    }
+
+    m_header = static_cast<Header*>(m_map);
+    m_slots = reinterpret_cast<Slot*>(m_header + 1);
+
+    std::uint64_t cap = m_header->capacity;
+    if (m_header->magic != store_magic || m_header->version != store_version || cap == 0
+        || (cap & (cap - 1)) != 0 || sizeof(Header) + cap * sizeof(Slot) != m_map_size)
+    {
+        ::munmap(m_map, m_map_size);
+        ::close(m_fd);
+        throw fail(path, "not a memo store");
+    }
+}
+
+MemoStore::~MemoStore()
+{
+    ::munmap(m_map, m_map_size);
+    ::close(m_fd);
+}
+
+auto MemoStore::lookup(MemoKey const& key) const -> std::optional<Result>
+{
+    std::uint64_t mask = m_header->capacity - 1;
+
+    for (std::uint64_t i = key.hash & mask;; i = (i + 1) & mask)
+    {
+        Slot const& slot = m_slots[i];
+        std::uint64_t hash = __atomic_load_n(&slot.hash, __ATOMIC_ACQUIRE);
+
+        if (hash == 0)
+        {
+            return std::nullopt;
+        }
+
+        if (hash == key.hash && slot.check == key.check)
+        {
+            return Result{slot.value, slot.error != 0, static_cast<ErrorKind>(slot.kind)};
+        }
+    }
+}
+
+auto MemoStore::insert(MemoKey const& key, Result const& result) -> bool
+{
+    if (!m_writable)
+    {
+        return false;
+    }
+
+    // Lookups read without the lock: they only trust a slot once its hash is published.
+    std::lock_guard<std::mutex> lock(m_insert_mutex);
+
+    std::uint64_t capacity = m_header->capacity;
+    std::uint64_t mask = capacity - 1;
+    for (std::uint64_t i = key.hash & mask;; i = (i + 1) & mask)
+    {
+        Slot& slot = m_slots[i];
+
+        if (slot.hash == key.hash && slot.check == key.check)
+        {
+            return true;
+        }
+
+        if (slot.hash == 0)
+        {
+            if (m_header->count >= room_for(capacity))
+            {
+                return false;
+            }
+
+            slot.check = key.check;
+            slot.value = result.result;
+            slot.error = result.error ? 1 : 0;
+            slot.kind = static_cast<std::uint8_t>(result.kind);
+            __atomic_store_n(&slot.hash, key.hash, __ATOMIC_RELEASE);
+            __atomic_store_n(&m_header->count, m_header->count + 1, __ATOMIC_RELEASE);
+
+            return true;
+        }
+    }
+}
+
+auto MemoStore::size() const -> std::size_t
+{
+    return std::size_t(__atomic_load_n(&m_header->count, __ATOMIC_ACQUIRE));
+}
+
+auto MemoStore::full() const -> bool
+{
+    return size() >= room_for(m_header->capacity);
+}
+
+auto evaluate(std::string const& input, MemoStore& store) -> Result
+{
+    thread_local std::vector<symbol> infix;
+    thread_local std::vector<symbol> postfix;
+    thread_local std::vector<char> ops;
+
+    infix.clear();
+    try
+    {
+        scan_tokens(input, infix);
+    }
+    catch (InfixError&)
+    {
+        return {0, true};
+    }
+
+    MemoKey key = memo_key(infix);
+    if (auto hit = store.lookup(key))
+    {
+        return *hit;
+    }
+
+    Result result{0, true};
+    try
+    {
+        postfix.clear();
+        ops.clear();
+        std::size_t max_depth = infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+        result = {evaluate_postfix(postfix, max_depth), false};
+    }
+    catch (InfixError&)
+    {
+    }
+
+    store.insert(key, result);
+
+    return result;
+}
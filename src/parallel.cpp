@@ -0,0 +1,574 @@
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "parallel.hpp"
+#include "policy.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+#include "token.hpp"
+
+namespace
+{
+    // Uninitialized storage for `count` values. The conversion tasks construct the program in
+    // place, each in its own block, so no single thread has to touch all of it first.
+    template<typename T>
+    class Buffer
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+
+    public:
+        explicit Buffer(std::size_t _count)
+            : m_data(std::allocator<T>().allocate(_count)),
+              m_count(_count)
+        {
+        }
+
+        Buffer(Buffer const&) = delete;
+        auto operator=(Buffer const&) -> Buffer& = delete;
+
+        ~Buffer()
+        {
+            std::allocator<T>().deallocate(m_data, m_count);
+        }
+
+        auto construct(std::size_t i, T value) -> void
+        {
+            ::new (static_cast<void*>(m_data + i)) T(value);
+        }
+
+        auto operator[](std::size_t i) const -> T const&
+        {
+            return m_data[i];
+        }
+
+    private:
+        T* m_data;
+        std::size_t m_count;
+    };
+
+    // A postfix program seen as a tree: the subtree rooted at symbol i spans the contiguous
+    // range [i + 1 - size[i], i] of the program.
+    struct Tree
+    {
+        Buffer<Token> postfix;
+        Buffer<std::size_t> size;
+        std::size_t max_depth;
+        std::size_t threshold;
+    };
+
+    // A parenthesis, with its index among the input's tokens and among its parentheses.
+    struct Paren
+    {
+        std::size_t index;
+        std::size_t rank;
+    };
+
+    // A pair of parentheses whose contents convert to `length` symbols. Only groups of at
+    // least the threshold are recorded: they are converted as ranges of their own.
+    struct Group
+    {
+        std::size_t open;
+        std::size_t close;
+        std::size_t length;
+    };
+
+    // One chunk of the input, scanned by its own task. Indices are relative to the chunk; the
+    // parentheses it cannot pair are paired across chunks afterwards.
+    struct Chunk
+    {
+        std::vector<Token> tokens;
+        std::vector<Group> groups;
+        std::vector<Paren> closes;
+        std::vector<Paren> opens;
+        std::size_t parens = 0;
+    };
+
+    // The input's tokens, left in the chunks that scanned them. Token i of the input is token
+    // i - first[k] of the chunk k that holds it; first has one more entry, the token count.
+    struct Tokens
+    {
+        std::vector<std::vector<Token>> chunks;
+        std::vector<std::size_t> first;
+    };
+
+    auto pair(Paren open, Paren close, std::size_t threshold, std::vector<Group>& groups)
+        -> void
+    {
+        // Everything between the two parentheses except the parentheses among it.
+        std::size_t length = (close.index - open.index) - (close.rank - open.rank);
+        if (length >= threshold)
+        {
+            groups.push_back({open.index, close.index, length});
+        }
+    }
+
+    // Whether scanning can start at `p`: the byte before it cannot be part of a number.
+    auto can_split(std::string_view input, std::size_t p) -> bool
+    {
+        auto is_exponent = [](char c) { return c == 'e' || c == 'E'; };
+
+        char c = input[p - 1];
+        if (is_digit(c) || c == '.' || is_exponent(c))
+        {
+            return false;
+        }
+
+        return !((c == '+' || c == '-') && p >= 2 && is_exponent(input[p - 2]));
+    }
+
+    auto scan_chunk(std::string_view text, std::size_t threshold) -> Chunk
+    {
+        Chunk chunk;
+        scan_tokens(text, chunk.tokens);
+
+        for (std::size_t i = 0; i < chunk.tokens.size(); i++)
+        {
+            Token token = chunk.tokens[i];
+            if (token.is_number())
+            {
+                continue;
+            }
+
+            if (token.op() == '(')
+            {
+                chunk.opens.push_back({i, chunk.parens++});
+            }
+            else if (token.op() == ')')
+            {
+                Paren close{i, chunk.parens++};
+                if (chunk.opens.empty())
+                {
+                    chunk.closes.push_back(close);
+                }
+                else
+                {
+                    pair(chunk.opens.back(), close, threshold, chunk.groups);
+                    chunk.opens.pop_back();
+                }
+            }
+        }
+
+        return chunk;
+    }
+
+    // Pairs the parentheses the chunks left over, moves the chunks' tokens into `tokens` and
+    // collects every group in the order of their opening parentheses. Returns the length of
+    // the program. Throws InfixError if the parentheses do not pair up.
+    auto stitch(std::vector<Chunk>& chunks, std::size_t threshold, Tokens& tokens,
+        std::vector<Group>& groups) -> std::size_t
+    {
+        std::vector<Paren> open;
+        std::size_t index = 0;
+        std::size_t rank = 0;
+
+        for (auto& chunk : chunks)
+        {
+            for (Paren close : chunk.closes)
+            {
+                if (open.empty())
+                {
+                    throw InfixError();
+                }
+
+                pair(open.back(), {index + close.index, rank + close.rank}, threshold, groups);
+                open.pop_back();
+            }
+
+            for (Paren p : chunk.opens)
+            {
+                open.push_back({index + p.index, rank + p.rank});
+            }
+
+            for (Group g : chunk.groups)
+            {
+                groups.push_back({index + g.open, index + g.close, g.length});
+            }
+
+            tokens.first.push_back(index);
+            index += chunk.tokens.size();
+            rank += chunk.parens;
+            tokens.chunks.push_back(std::move(chunk.tokens));
+        }
+
+        if (!open.empty())
+        {
+            throw InfixError();
+        }
+
+        tokens.first.push_back(index);
+        std::sort(groups.begin(), groups.end(), [](Group const& a, Group const& b) {
+            return a.open < b.open;
+        });
+
+        return index - rank;
+    }
+
+    // A symbol of a range, or a group standing in for one operand.
+    struct Item
+    {
+        Token token;
+        Group const* group;
+    };
+
+    auto is_number(Item const& item) -> bool
+    {
+        return item.group != nullptr || item.token.is_number();
+    }
+
+    auto as_operator(Item const& item) -> char
+    {
+        return item.token.op();
+    }
+
+    // Walks the input's tokens for infix_to_postfix_into. With `skip` set, every recorded
+    // group is presented as a single operand and stepped over as a whole.
+    class Cursor
+    {
+    public:
+        Cursor(Tokens const& _tokens, std::vector<Group> const& _groups, std::size_t _pos,
+            bool _skip)
+            : m_tokens(&_tokens),
+              m_pos(_pos),
+              m_chunk(std::size_t(
+                  std::upper_bound(_tokens.first.begin(), _tokens.first.end() - 1, _pos)
+                  - _tokens.first.begin() - 1)),
+              m_next(std::lower_bound(_groups.data(), _groups.data() + _groups.size(), _pos,
+                  [](Group const& g, std::size_t pos) { return g.open < pos; })),
+              m_end(_groups.data() + _groups.size()),
+              m_skip(_skip)
+        {
+        }
+
+        auto operator*() const -> Item
+        {
+            if (at_group())
+            {
+                return {Token('('), m_next};
+            }
+
+            return {m_tokens->chunks[m_chunk][m_pos - m_tokens->first[m_chunk]], nullptr};
+        }
+
+        auto operator++(int) -> Cursor
+        {
+            Cursor ret = *this;
+            if (at_group())
+            {
+                // The groups nested in this one open before it closes.
+                m_pos = m_next->close + 1;
+                m_next = std::upper_bound(m_next, m_end, m_next->close,
+                    [](std::size_t pos, Group const& g) { return pos < g.open; });
+            }
+            else
+            {
+                m_pos++;
+            }
+
+            auto const& first = m_tokens->first;
+            while (m_chunk + 1 < m_tokens->chunks.size() && m_pos >= first[m_chunk + 1])
+            {
+                m_chunk++;
+            }
+
+            return ret;
+        }
+
+        auto operator==(Cursor const& other) const -> bool
+        {
+            return m_pos == other.m_pos;
+        }
+
+        auto operator!=(Cursor const& other) const -> bool
+        {
+            return m_pos != other.m_pos;
+        }
+
+    private:
+        [[nodiscard]] auto at_group() const -> bool
+        {
+            return m_skip && m_next != m_end && m_next->open == m_pos;
+        }
+
+        Tokens const* m_tokens;
+        std::size_t m_pos;
+        std::size_t m_chunk;
+        Group const* m_next;
+        Group const* m_end;
+        bool m_skip;
+    };
+
+    // A range of the input's tokens that converts into the block of the program starting at
+    // `offset`, with `depth` values already on the stack below it.
+    struct Range
+    {
+        std::size_t begin;
+        std::size_t end;
+        std::size_t offset;
+        std::size_t depth;
+    };
+
+    // The postfix container a range converts into. It writes the range's block of the program
+    // in place, with the size of every subtree and the depth of the value stack, and defers
+    // the groups the cursor steps over to ranges of their own.
+    class Emitter
+    {
+    public:
+        Emitter(Tree& _tree, Range const& _range, std::vector<Range>& _deferred)
+            : m_tree(_tree),
+              m_deferred(_deferred),
+              m_next(_range.offset),
+              m_depth(_range.depth),
+              m_max_depth(_range.depth)
+        {
+        }
+
+        auto emplace_back(Item const& item) -> void
+        {
+            std::size_t size = 1;
+            if (item.group != nullptr)
+            {
+                size = item.group->length;
+                m_deferred.push_back(
+                    {item.group->open + 1, item.group->close, m_next, m_depth});
+            }
+            else
+            {
+                m_tree.postfix.construct(m_next, item.token);
+                m_tree.size.construct(m_next, 1);
+            }
+
+            m_next += size;
+            m_roots.push_back(size);
+            m_max_depth = std::max(m_max_depth, ++m_depth);
+        }
+
+        auto emplace_back(char op) -> void
+        {
+            std::size_t size = m_roots.back() + 1;
+            m_roots.pop_back();
+            size += m_roots.back();
+            m_roots.back() = size;
+
+            m_tree.postfix.construct(m_next, Token(op));
+            m_tree.size.construct(m_next, size);
+            m_next++;
+            m_depth--;
+        }
+
+        [[nodiscard]] auto max_depth() const -> std::size_t
+        {
+            return m_max_depth;
+        }
+
+    private:
+        Tree& m_tree;
+        std::vector<Range>& m_deferred;
+        std::vector<std::size_t> m_roots;
+        std::size_t m_next;
+        std::size_t m_depth;
+        std::size_t m_max_depth;
+    };
+
+    // Converts `range` and the groups deferred from it, handing deferred groups to other
+    // threads while the budget lasts. Returns the deepest the value stack gets in them.
+    auto convert(Tree& tree, Tokens const& tokens, std::vector<Group> const& groups,
+        Range range, unsigned budget) -> std::size_t
+    {
+        std::vector<std::future<std::size_t>> spawned;
+        std::vector<Range> work{range};
+        std::vector<Range> deferred;
+        std::vector<char> ops;
+        std::size_t max_depth = 0;
+
+        while (!work.empty())
+        {
+            Range next = work.back();
+            work.pop_back();
+
+            Emitter out(tree, next, deferred);
+            ops.clear();
+            infix_to_postfix_into(Cursor(tokens, groups, next.begin, budget > 0),
+                Cursor(tokens, groups, next.end, false), out, ops);
+            max_depth = std::max(max_depth, out.max_depth());
+
+            // The last deferred group stays on this thread, as do the ones past the budget.
+            for (std::size_t i = 0; i < deferred.size(); i++)
+            {
+                if (budget == 0 || i + 1 == deferred.size())
+                {
+                    work.push_back(deferred[i]);
+                    continue;
+                }
+
+                unsigned child_budget = (budget - 1) / 2;
+                budget -= 1 + child_budget;
+
+                spawned.push_back(std::async(std::launch::async, convert, std::ref(tree),
+                    std::cref(tokens), std::cref(groups), deferred[i], child_budget));
+            }
+
+            deferred.clear();
+        }
+
+        for (auto& s : spawned)
+        {
+            max_depth = std::max(max_depth, s.get());
+        }
+
+        return max_depth;
+    }
+
+    struct Spawned
+    {
+        std::size_t first;
+        std::size_t root;
+        std::future<double> value;
+    };
+
+    auto subtree_first(Tree const& tree, std::size_t root) -> std::size_t
+    {
+        return root + 1 - tree.size[root];
+    }
+
+    auto evaluate_subtree(Tree const& tree, std::size_t root, unsigned budget) -> double
+    {
+        std::vector<Spawned> spawned;
+        std::vector<std::size_t> pending;
+
+        // Walk the subtree from its root towards its first symbol, handing the left operand of
+        // every operator whose operands are both large to another thread. The right operand is
+        // scanned next, so it stays on this thread.
+        std::size_t first = subtree_first(tree, root);
+        for (std::size_t j = root + 1; budget > 0 && j-- > first;)
+        {
+            if (!pending.empty() && pending.back() == j)
+            {
+                j = subtree_first(tree, j);
+                pending.pop_back();
+                continue;
+            }
+
+            if (tree.size[j] == 1)
+            {
+                continue;
+            }
+
+            std::size_t right = j - 1;
+            std::size_t left = right - tree.size[right];
+
+            if (tree.size[left] >= tree.threshold && tree.size[right] >= tree.threshold)
+            {
+                unsigned child_budget = (budget - 1) / 2;
+                budget -= 1 + child_budget;
+
+                spawned.push_back(
+                    {subtree_first(tree, left),
+                     left,
+                     std::async(std::launch::async, evaluate_subtree, std::cref(tree), left,
+                         child_budget)});
+                pending.push_back(left);
+            }
+        }
+
+        std::sort(spawned.begin(), spawned.end(), [](Spawned const& a, Spawned const& b) {
+            return a.first < b.first;
+        });
+
+        std::vector<double> stack(tree.max_depth);
+        double* top = stack.data();
+        auto next = spawned.begin();
+
+        for (std::size_t i = first; i <= root; i++)
+        {
+            if (next != spawned.end() && next->first == i)
+            {
+                *top++ = next->value.get();
+                i = next->root;
+                ++next;
+            }
+            else if (tree.postfix[i].is_number())
+            {
+                *top++ = tree.postfix[i].number();
+            }
+            else
+            {
+                top--;
+                top[-1] = get_operator(tree.postfix[i].op()).fn(top[-1], *top);
+            }
+        }
+
+        return stack[0];
+    }
+}
+
+auto evaluate_parallel(std::string const& input, std::size_t threshold, unsigned threads)
+    -> Result
+{
+    threshold = std::max<std::size_t>(threshold, 1);
+    if (threads == 0)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    // Without two subtrees of the threshold there is nothing to hand out.
+    if (threads == 1 || input.size() < 2 * threshold)
+    {
+        return evaluate_with<compact_policy>(input);
+    }
+
+    try
+    {
+        // Scan in one chunk per thread, splitting only where no number can continue.
+        std::size_t chunk_count = std::min<std::size_t>(threads, input.size() / threshold);
+        std::vector<std::size_t> bounds{0};
+        for (std::size_t k = 1; k < chunk_count; k++)
+        {
+            std::size_t p = std::max(bounds.back(), input.size() * k / chunk_count);
+            while (p < input.size() && !can_split(input, p))
+            {
+                p++;
+            }
+
+            bounds.push_back(p);
+        }
+        bounds.push_back(input.size());
+
+        std::string_view text = input;
+        std::vector<std::future<Chunk>> scans;
+        for (std::size_t k = 1; k < chunk_count; k++)
+        {
+            scans.push_back(std::async(std::launch::async, scan_chunk,
+                text.substr(bounds[k], bounds[k + 1] - bounds[k]), threshold));
+        }
+
+        std::vector<Chunk> chunks;
+        chunks.push_back(scan_chunk(text.substr(0, bounds[1]), threshold));
+        for (auto& scan : scans)
+        {
+            chunks.push_back(scan.get());
+        }
+
+        Tokens tokens;
+        std::vector<Group> groups;
+        std::size_t length = stitch(chunks, threshold, tokens, groups);
+
+        Tree tree{Buffer<Token>(length), Buffer<std::size_t>(length), 0, threshold};
+        Range whole{0, tokens.first.back(), 0, 0};
+        tree.max_depth = convert(tree, tokens, groups, whole, threads - 1);
+
+        return {evaluate_subtree(tree, length - 1, threads - 1), false};
+    }
+    catch (InfixError&)
+    {
+        return {0, true};
+    }
+}
@@ -0,0 +1,143 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "scanner.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    auto classify_scalar(char const* p, std::size_t n) -> char_masks
+    {
+        char_masks masks{0, 0, 0};
+
+        for (std::size_t i = 0; i < n; i++)
+        {
+            char c = p[i];
+
+            if (is_space(c))
+            {
+                masks.space |= std::uint64_t{1} << i;
+            }
+            else if (is_digit(c))
+            {
+                masks.digit |= std::uint64_t{1} << i;
+                masks.number |= std::uint64_t{1} << i;
+            }
+            else if (c == '.' || c == 'e' || c == 'E')
+            {
+                masks.number |= std::uint64_t{1} << i;
+            }
+        }
+
+        return masks;
+    }
+
+#ifdef SCANNER_X86
+    // Both vector versions classify a whole, zero padded, 64 byte block. Signed comparisons
+    // are fine: bytes above 0x7f are negative and match no class. Setting bit 5 folds 'E'
+    // onto 'e'.
+
+    __attribute__((target("sse2"))) auto classify_sse2(char const* block) -> char_masks
+    {
+        char_masks masks{0, 0, 0};
+
+        for (unsigned i = 0; i < scan_block_size; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block + i));
+
+            __m128i space = _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                _mm_and_si128(
+                    _mm_cmpgt_epi8(v, _mm_set1_epi8('\t' - 1)),
+                    _mm_cmplt_epi8(v, _mm_set1_epi8('\r' + 1))));
+            __m128i digit = _mm_and_si128(
+                _mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+            __m128i number = _mm_or_si128(
+                _mm_or_si128(digit, _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))),
+                _mm_cmpeq_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('e')));
+
+            masks.space |= std::uint64_t(unsigned(_mm_movemask_epi8(space))) << i;
+            masks.digit |= std::uint64_t(unsigned(_mm_movemask_epi8(digit))) << i;
+            masks.number |= std::uint64_t(unsigned(_mm_movemask_epi8(number))) << i;
+        }
+
+        return masks;
+    }
+
+    __attribute__((target("avx2"))) auto classify_avx2(char const* block) -> char_masks
+    {
+        char_masks masks{0, 0, 0};
+
+        for (unsigned i = 0; i < scan_block_size; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block + i));
+
+            __m256i space = _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                _mm256_and_si256(
+                    _mm256_cmpgt_epi8(v, _mm256_set1_epi8('\t' - 1)),
+                    _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), v)));
+            __m256i digit = _mm256_and_si256(
+                _mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+            __m256i number = _mm256_or_si256(
+                _mm256_or_si256(digit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.'))),
+                _mm256_cmpeq_epi8(
+                    _mm256_or_si256(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('e')));
+
+            masks.space |= std::uint64_t(unsigned(_mm256_movemask_epi8(space))) << i;
+            masks.digit |= std::uint64_t(unsigned(_mm256_movemask_epi8(digit))) << i;
+            masks.number |= std::uint64_t(unsigned(_mm256_movemask_epi8(number))) << i;
+        }
+
+        return masks;
+    }
+
+    using classify_fn = auto (*)(char const*) -> char_masks;
+
+    auto select_classifier() -> classify_fn
+    {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return classify_avx2;
+        }
+
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return classify_sse2;
+        }
+
+        return nullptr;
+    }
+#endif
+}
+
+auto classify_block(char const* p, std::size_t n) -> char_masks
+{
+#ifdef SCANNER_X86
+    static classify_fn const classify = select_classifier();
+
+    if (classify != nullptr)
+    {
+        if (n == scan_block_size)
+        {
+            return classify(p);
+        }
+
+        char padded[scan_block_size] = {};
+        std::memcpy(padded, p, n);
+
+        return classify(padded);
+    }
+#endif
+
+    return classify_scalar(p, n);
+}
@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "scanner.hpp"
+#include "script.hpp"
+#include "solution.hpp"
+
+namespace
+{
+    // Symbols of a definition's expression. infix_to_postfix_into only tells operands from
+    // operators, so names go through it just like numbers do.
+    struct ScriptToken
+    {
+        enum class Kind
+        {
+            number,
+            slot,
+            op
+        };
+
+        Kind kind;
+        char op;
+        std::size_t slot;
+        double value;
+
+        ScriptToken(char _op)
+            : kind(Kind::op),
+              op(_op),
+              slot(0),
+              value(0)
+        {
+        }
+
+        ScriptToken(double _value)
+            : ScriptToken(Kind::number, 0, _value)
+        {
+        }
+
+        ScriptToken(Kind _kind, std::size_t _slot, double _value)
+            : kind(_kind),
+              op(0),
+              slot(_slot),
+              value(_value)
+        {
+        }
+    };
+
+    auto is_number(ScriptToken const& t) -> bool
+    {
+        return t.kind != ScriptToken::Kind::op;
+    }
+
+    auto as_operator(ScriptToken const& t) -> char
+    {
+        return t.op;
+    }
+
+    auto trim(std::string_view s) -> std::string_view
+    {
+        while (!s.empty() && is_space(s.front()))
+        {
+            s.remove_prefix(1);
+        }
+
+        while (!s.empty() && is_space(s.back()))
+        {
+            s.remove_suffix(1);
+        }
+
+        return s;
+    }
+
+    struct Statement
+    {
+        std::string_view name;
+        std::string_view expression;
+    };
+
+    // Splits the source on ';' and newlines into "name = expression" statements, skipping
+    // empty ones.
+    auto split_statements(std::string const& source) -> std::vector<Statement>
+    {
+        std::vector<Statement> statements;
+        std::string_view rest = source;
+
+        while (!rest.empty())
+        {
+            std::size_t end = std::min(rest.find(';'), rest.find('\n'));
+            std::string_view statement = trim(rest.substr(0, end));
+            rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+
+            if (statement.empty())
+            {
+                continue;
+            }
+
+            std::size_t eq = statement.find('=');
+            if (eq == std::string_view::npos)
+            {
+                throw InfixError();
+            }
+
+            std::string_view name = trim(statement.substr(0, eq));
+            if (name.empty() || !is_name_start(name.front())
+                || !std::all_of(name.begin(), name.end(), is_name_char))
+            {
+                throw InfixError();
+            }
+
+            statements.push_back({name, statement.substr(eq + 1)});
+        }
+
+        return statements;
+    }
+}
+
+Script::Script(std::string const& source)
+{
+    std::vector<Statement> statements = split_statements(source);
+
+    // Definitions take slots [0, D) and inputs the slots after them.
+    std::unordered_map<std::string_view, std::size_t> defined;
+    for (auto const& statement : statements)
+    {
+        if (!defined.try_emplace(statement.name, m_names.size()).second)
+        {
+            throw InfixError();
+        }
+
+        m_names.emplace_back(statement.name);
+    }
+
+    std::unordered_map<std::string_view, std::size_t> inputs;
+    std::vector<std::size_t> level_of(statements.size(), 0);
+
+    for (std::size_t d = 0; d < statements.size(); d++)
+    {
+        // The expression grammar is tokenize's, with names as operands.
+        std::vector<ScriptToken> infix;
+        scan_tokens(statements[d].expression, infix, [&](std::string_view name) {
+            std::size_t slot = 0;
+            if (auto it = defined.find(name); it != defined.end())
+            {
+                // Only earlier definitions can be used.
+                if (it->second >= d)
+                {
+                    throw InfixError();
+                }
+
+                slot = it->second;
+                level_of[d] = std::max(level_of[d], level_of[slot] + 1);
+            }
+            else
+            {
+                auto [input, added] = inputs.try_emplace(name, m_inputs.size());
+                if (added)
+                {
+                    m_inputs.emplace_back(name);
+                }
+
+                slot = statements.size() + input->second;
+            }
+
+            infix.emplace_back(ScriptToken::Kind::slot, slot, 0.0);
+        });
+
+        std::vector<ScriptToken> postfix;
+        std::vector<char> ops;
+        std::size_t max_depth = infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+
+        Definition definition{{}, max_depth};
+
+        for (auto const& t : postfix)
+        {
+            definition.postfix.push_back(
+                {t.kind == ScriptToken::Kind::op,
+                 t.op,
+                 t.kind == ScriptToken::Kind::slot ? t.slot : no_slot,
+                 t.value});
+        }
+
+        m_definitions.push_back(std::move(definition));
+
+        if (m_levels.size() <= level_of[d])
+        {
+            m_levels.resize(level_of[d] + 1);
+        }
+
+        m_levels[level_of[d]].push_back(d);
+    }
+}
+
+auto Script::evaluate_definition(std::size_t d, std::vector<double>& columns, std::size_t rows,
+    std::size_t first_row, std::size_t last_row) const -> void
+{
+    Definition const& definition = m_definitions[d];
+    std::vector<double> stack(definition.max_depth);
+
+    for (std::size_t row = first_row; row < last_row; row++)
+    {
+        double* top = stack.data();
+
+        for (auto const& step : definition.postfix)
+        {
+            if (!step.is_op)
+            {
+                *top++ = step.slot == no_slot ? step.value : columns[step.slot * rows + row];
+            }
+            else
+            {
+                top--;
+                top[-1] = get_operator(step.op).fn(top[-1], *top);
+            }
+        }
+
+        columns[d * rows + row] = stack[0];
+    }
+}
+
+auto Script::evaluate(double const* inputs, std::size_t rows, double* outputs,
+    unsigned threads) const -> void
+{
+    std::size_t definitions = m_definitions.size();
+    std::size_t input_count = m_inputs.size();
+
+    // One column per slot, so every definition is computed once per row and read by the
+    // definitions that use it.
+    std::vector<double> columns((definitions + input_count) * rows);
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        for (std::size_t i = 0; i < input_count; i++)
+        {
+            columns[(definitions + i) * rows + row] = inputs[row * input_count + i];
+        }
+    }
+
+    threads = std::max(threads, 1U);
+    std::size_t chunk = std::max<std::size_t>((rows + threads - 1) / threads, 1);
+
+    for (auto const& level : m_levels)
+    {
+        // A task is one definition over one chunk of rows.
+        std::size_t chunks = (rows + chunk - 1) / chunk;
+        std::size_t tasks = level.size() * chunks;
+        std::atomic<std::size_t> next{0};
+
+        auto work = [&] {
+            for (std::size_t t = next++; t < tasks; t = next++)
+            {
+                std::size_t first_row = t % chunks * chunk;
+                evaluate_definition(level[t / chunks], columns, rows, first_row,
+                    std::min(rows, first_row + chunk));
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t w = 1; w < std::min<std::size_t>(threads, tasks); w++)
+        {
+            workers.emplace_back(work);
+        }
+
+        work();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        for (std::size_t d = 0; d < definitions; d++)
+        {
+            outputs[row * definitions + d] = columns[d * rows + row];
+        }
+    }
+}
+
+auto Script::evaluate(std::vector<double> const& inputs) const -> std::vector<double>
+{
+    if (inputs.size() != m_inputs.size())
+    {
+        throw std::invalid_argument("Script::evaluate expects one value per input");
+    }
+
+    std::vector<double> outputs(m_names.size());
+    evaluate(inputs.data(), 1, outputs.data());
+
+    return outputs;
+}
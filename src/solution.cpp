@@ -1,12 +1,11 @@
-#include <cctype>
+#include <cstddef>
 #include <functional>
-#include <istream>
-#include <iterator>
-#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <variant>
 
+#include "policy.hpp"
+#include "scanner.hpp"
 #include "solution.hpp"
 
 auto get_operator(char c) -> Operator
@@ -28,85 +27,28 @@ auto get_operator(char c) -> Operator
     };
 }
 
-auto read_double(std::istringstream& in) -> double
+auto is_operator(char c) -> bool
 {
-    double ret = 0;
-    in >> ret;
-
-    return ret;
-}
-
-auto next_token(std::istringstream& in) -> symbol
-{
-    if (std::isdigit(in.peek()) != 0)
+    switch (c)
     {
-        return read_double(in);
-    }
-
-    return char(in.get());
+    case '*':
+    case '/':
+    case '+':
+    case '-':
+        return true;
+    default:
+        return false;
+    };
 }
 
 auto tokenize(std::string const& input) -> eval_container<symbol>
 {
-    std::istringstream in{input};
-
     eval_container<symbol> ret;
-
-    while (in >> std::ws, !in.eof())
-    {
-        ret.push_back(next_token(in));
-    }
+    scan_tokens(input, ret);
 
     return ret;
 }
 
-template<template<typename...> typename container>
-auto evaluate(container<symbol> const& cn) -> Result
-{
-    if (cn.empty())
-    {
-        return {0, true};
-    }
-
-    container<double> result;
-    for (auto const& e : cn)
-    {
-        try
-        {
-            std::visit(
-                overload{
-                    [&result](double d) { result.push_back(d); },
-                    [&result](char c) {
-                        if (result.size() < 2)
-                        {
-                            throw EvalError();
-                        }
-                        else
-                        {
-                            double a1 = result.back();
-                            result.pop_back();
-                            double a2 = result.back();
-                            result.pop_back();
-
-                            result.push_back(get_operator(c).fn(a2, a1));
-                        }
-                    }},
-                e);
-        }
-        catch (EvalError&)
-        {
-            return {0, true};
-        }
-    }
-
-    if (result.size() != 1)
-    {
-        return {0, true};
-    }
-
-    return {result.back(), false};
-}
-
 auto evaluate(std::string const& input) -> Result
 {
     // 1- descomponer el input y validar
@@ -117,16 +59,7 @@ auto evaluate(std::string const& input) -> Result
 
     //* Si no cumple la validacion retornar Result.error = true;
 
-    try
-    {
-        auto infix = infix_to_postfix(tokenize(input));
-
-        return evaluate(infix);
-    }
-    catch (InfixError&)
-    {
-        return {0, true};
-    }
+    return evaluate_with<compact_policy>(input);
 }
 
 auto operator<<(std::ostream& out, std::variant<double, char> const& v) -> std::ostream&
@@ -0,0 +1,43 @@
+#include <cfenv>
+#include <string>
+
+#include "solution.hpp"
+#include "strict.hpp"
+
+auto strict_error(int raised, ErrorKind& kind) -> bool
+{
+    if ((raised & FE_DIVBYZERO) != 0)
+    {
+        kind = ErrorKind::divide_by_zero;
+    }
+    else if ((raised & FE_INVALID) != 0)
+    {
+        kind = ErrorKind::invalid_operation;
+    }
+    else if ((raised & FE_OVERFLOW) != 0)
+    {
+        kind = ErrorKind::overflow;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+auto evaluate_strict(std::string const& input) -> Result
+{
+    ExceptionFlagsGuard guard;
+    std::feclearexcept(FE_ALL_EXCEPT);
+
+    Result result = evaluate(input);
+
+    ErrorKind kind{};
+    if (!result.error && strict_error(std::fetestexcept(strict_exceptions), kind))
+    {
+        return {0, true, kind};
+    }
+
+    return result;
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "flat.hpp"
+#include "scanner.hpp"
+#include "solution.hpp"
+#include "tiered.hpp"
+
+struct TieredEvaluator::Entry
+{
+    bool error = false;
+    std::vector<symbol> postfix;
+    std::size_t max_depth = 0;
+
+    std::atomic<std::uint64_t> count{0};
+    // Set when evaluated again, cleared when the evictor passes the entry over.
+    std::atomic<bool> referenced{false};
+
+    // Written once by the compiler thread before `compiled` is published.
+    std::unique_ptr<FlatProgram> owned;
+    std::atomic<FlatProgram const*> compiled{nullptr};
+};
+
+TieredEvaluator::TieredEvaluator()
+    : TieredEvaluator(Options{})
+{
+}
+
+TieredEvaluator::TieredEvaluator(Options options)
+    : m_options{
+        std::max<std::uint64_t>(options.promote_after, 1),
+        std::max<std::size_t>(options.capacity, 1)},
+      m_compiler(&TieredEvaluator::compile_loop, this)
+{
+}
+
+TieredEvaluator::~TieredEvaluator()
+{
+    {
+        std::lock_guard lock(m_queue_mutex);
+        m_stop = true;
+    }
+
+    m_queue_cv.notify_all();
+    m_compiler.join();
+}
+
+auto TieredEvaluator::parse(std::string const& input) -> std::shared_ptr<Entry>
+{
+    auto entry = std::make_shared<Entry>();
+    try
+    {
+        std::vector<symbol> infix;
+        scan_tokens(input, infix);
+
+        std::vector<char> ops;
+        entry->max_depth =
+            infix_to_postfix_into(infix.begin(), infix.end(), entry->postfix, ops);
+    }
+    catch (InfixError&)
+    {
+        entry->error = true;
+    }
+
+    return entry;
+}
+
+auto TieredEvaluator::insert(std::string const& input, std::shared_ptr<Entry> entry)
+    -> std::shared_ptr<Entry>
+{
+    std::unique_lock lock(m_entries_mutex);
+    auto [it, inserted] = m_entries.try_emplace(input, std::move(entry));
+    std::shared_ptr<Entry> ret = it->second;
+    if (!inserted)
+    {
+        return ret;
+    }
+
+    m_order.push_back(&it->first);
+
+    // Second chance: an entry evaluated since the evictor last passed it is moved to the back
+    // instead, so expressions seen once go first. Even the one just added may go, which only
+    // drops it from the cache; the caller still holds it.
+    while (m_entries.size() > m_options.capacity)
+    {
+        std::string const* key = m_order.front();
+        m_order.pop_front();
+
+        auto victim = m_entries.find(*key);
+        if (victim->second->referenced.exchange(false, std::memory_order_relaxed))
+        {
+            m_order.push_back(key);
+            continue;
+        }
+
+        m_entries.erase(victim);
+        m_evictions++;
+    }
+
+    return ret;
+}
+
+auto TieredEvaluator::evaluate(std::string const& input) -> Result
+{
+    {
+        // Entries are only evicted under the unique lock, so this one outlives the call.
+        std::shared_lock lock(m_entries_mutex);
+        auto it = m_entries.find(input);
+        if (it != m_entries.end())
+        {
+            // Read first, so a hot entry's cache line is not written on every call.
+            if (!it->second->referenced.load(std::memory_order_relaxed))
+            {
+                it->second->referenced.store(true, std::memory_order_relaxed);
+            }
+
+            return run(it->second);
+        }
+    }
+
+    return run(insert(input, parse(input)));
+}
+
+auto TieredEvaluator::run(std::shared_ptr<Entry> const& entry) -> Result
+{
+    if (entry->error)
+    {
+        m_errors.fetch_add(1, std::memory_order_relaxed);
+
+        return {0, true};
+    }
+
+    if (auto const* program = entry->compiled.load(std::memory_order_acquire))
+    {
+        m_compiled.fetch_add(1, std::memory_order_relaxed);
+
+        return {program->run(), false};
+    }
+
+    if (entry->count.fetch_add(1, std::memory_order_relaxed) + 1 == m_options.promote_after)
+    {
+        {
+            // The queue keeps the entry alive if it is evicted before it is compiled.
+            std::lock_guard lock(m_queue_mutex);
+            m_queue.push_back(entry);
+        }
+
+        m_queue_cv.notify_one();
+    }
+
+    m_interpreted.fetch_add(1, std::memory_order_relaxed);
+
+    return {evaluate_postfix(entry->postfix, entry->max_depth), false};
+}
+
+auto TieredEvaluator::compile_loop() -> void
+{
+    std::unique_lock lock(m_queue_mutex);
+
+    while (true)
+    {
+        m_queue_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+        {
+            return;
+        }
+
+        std::shared_ptr<Entry> entry = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_compiling = true;
+        lock.unlock();
+
+        entry->owned = std::make_unique<FlatProgram>(entry->postfix, entry->max_depth);
+        entry->compiled.store(entry->owned.get(), std::memory_order_release);
+        m_promotions.fetch_add(1, std::memory_order_relaxed);
+
+        lock.lock();
+        m_compiling = false;
+        if (m_queue.empty())
+        {
+            m_idle_cv.notify_all();
+        }
+    }
+}
+
+auto TieredEvaluator::wait_for_promotions() -> void
+{
+    std::unique_lock lock(m_queue_mutex);
+    m_idle_cv.wait(lock, [this] { return m_queue.empty() && !m_compiling; });
+}
+
+auto TieredEvaluator::counters() const -> Counters
+{
+    std::shared_lock lock(m_entries_mutex);
+
+    return {
+        m_interpreted.load(std::memory_order_relaxed),
+        m_compiled.load(std::memory_order_relaxed),
+        m_errors.load(std::memory_order_relaxed),
+        m_promotions.load(std::memory_order_relaxed),
+        m_evictions};
+}
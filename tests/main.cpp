@@ -1,8 +1,33 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <variant>
 #include <vector>
 
+#include "admission.hpp"
+#include "batch.hpp"
+#include "builder.hpp"
 #include "circular.hpp"
+#include "document.hpp"
+#include "flat.hpp"
+#include "fused.hpp"
+#include "memo.hpp"
+#include "parallel.hpp"
+#include "policy.hpp"
+#include "script.hpp"
 #include "solution.hpp"
+#include "strict.hpp"
+#include "tiered.hpp"
+#include "token.hpp"
 
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
@@ -27,3 +52,683 @@ TEST_CASE("evaluate", "[evaluate]")
     CHECK(evaluate("(6 + 8) / (5 + 2) * 3 +") == Result{0, true});
     CHECK(evaluate("(6 + 8) 10 / (5 + 2) * 3 +") == Result{0, true});
 }
+
+TEST_CASE("infix_to_postfix validation", "[evaluate]")
+{
+    std::size_t max_depth = 0;
+    auto infix = tokenize("1 + (2 * (3 - 4)) / 5");
+    CHECK(
+        infix_to_postfix<CircularList>(infix.begin(), infix.end(), max_depth)
+        == CircularList<std::variant<double, char>>{
+            1.0, 2.0, 3.0, 4.0, '-', '*', 5.0, '/', '+'});
+    CHECK(max_depth == 4);
+
+    CHECK_THROWS_AS(infix_to_postfix(tokenize("(1 + 2")), InfixError);
+    CHECK_THROWS_AS(infix_to_postfix(tokenize("1 + 2)")), InfixError);
+    CHECK_THROWS_AS(infix_to_postfix(tokenize("1 +")), InfixError);
+    CHECK_THROWS_AS(infix_to_postfix(tokenize("()")), InfixError);
+
+    CHECK(evaluate("((1 + 2) * (3 + 4)) - ((5 - 6) / 2)") == Result{21.5, false});
+    CHECK(evaluate(") 1 + 2") == Result{0, true});
+    CHECK(evaluate("5 % 2") == Result{0, true});
+    CHECK(evaluate(".5 + 1") == Result{0, true});
+
+    std::string deep = "1";
+    for (int i = 0; i < 100; i++)
+    {
+        deep = "1 + (" + deep + ")";
+    }
+    CHECK(evaluate(deep) == Result{101, false});
+}
+
+TEST_CASE("tokenize long input", "[tokenize]")
+{
+    using circ_list = CircularList<std::variant<double, char>>;
+
+    CHECK(
+        tokenize(" \t1.5*\n(20  -3e2)\r\n")
+        == circ_list{1.5, '*', '(', 20.0, '-', 300.0, ')'});
+    CHECK(tokenize("   ") == circ_list{});
+
+    std::string input;
+    circ_list expected;
+    for (int i = 0; i < 200; i++)
+    {
+        input += std::to_string(i) + (i % 3 == 0 ? "   +\t" : " + ");
+        expected.emplace_back(double(i));
+        expected.emplace_back('+');
+    }
+    input += "12345";
+    expected.emplace_back(12345.0);
+
+    CHECK(tokenize(input) == expected);
+    CHECK(evaluate(input) == Result{199 * 200 / 2 + 12345, false});
+
+    // Numbers across a block boundary, longer than the fast path reads, or left to from_chars.
+    std::string spans(60, ' ');
+    spans += "1234567.25 + 12345678901234567890 * 3. - 2.5e3 / 1.5.5 + 0.1";
+    CHECK(
+        tokenize(spans)
+        == circ_list{
+            1234567.25, '+', 12345678901234567890.0, '*', 3.0, '-', 2500.0, '/', 1.5, '.', 5.0,
+            '+', 0.1});
+
+    // Numbers below the range of double read as 0, as they did with istream; numbers above it
+    // are errors.
+    std::string tiny = "0." + std::string(400, '0') + "1";
+    CHECK(evaluate("1e-400 + 1") == Result{1, false});
+    CHECK(evaluate("2.4e-324 * 3 + 1e-310") == Result{1e-310, false});
+    CHECK(
+        evaluate("123456e-330 + " + tiny + " + 0.5e-99999999999999999999999")
+        == Result{0, false});
+    CHECK(evaluate("1e999 + 1") == Result{0, true});
+    CHECK(evaluate("1.7976931348623159e308") == Result{0, true});
+    CHECK(evaluate("0.001e311") == Result{1e308, false});
+    CHECK(Document("2 * (1e-400 + 3)").result() == Result{6, false});
+}
+
+TEST_CASE("evaluate_parallel", "[parallel]")
+{
+    CHECK(evaluate_parallel("(6 + 8) / (5 + 2) * 12") == Result{24, false});
+    CHECK(evaluate_parallel("(6 + 8) / (5 + 2) * 3 +") == Result{0, true});
+
+    // Balanced tree with inexact divisions so any change in association would show up.
+    std::string input = "0.1";
+    for (int i = 0; i < 10; i++)
+    {
+        input = "(" + input + (i % 2 == 0 ? " / 3 + " : " - 7 * ") + input + ")";
+    }
+    input = "1 - 2 / 3 * " + input + " + 0.3";
+
+    Result serial = evaluate(input);
+    CHECK(evaluate_parallel(input, 8, 4) == serial);
+    CHECK(evaluate_parallel(input, 64, 3) == serial);
+    CHECK(evaluate_parallel(input, 1, 16) == serial);
+
+    // Errors inside groups converted on their own, and parentheses paired across chunks.
+    CHECK(evaluate_parallel(input + " 2", 8, 4) == Result{0, true});
+    CHECK(evaluate_parallel("(" + input + " * (1 2))", 8, 4) == Result{0, true});
+    CHECK(evaluate_parallel("(" + input, 8, 4) == Result{0, true});
+    CHECK(evaluate_parallel(input + ")", 8, 4) == Result{0, true});
+    CHECK(evaluate_parallel(input + " + 1e999", 8, 4) == Result{0, true});
+
+    // Chunks may only split where no number continues, exponents included.
+    std::string exponents;
+    for (int i = 0; i < 500; i++)
+    {
+        exponents += std::to_string(i % 9 + 1) + (i % 2 == 0 ? ".5e+1" : "E-2")
+            + (i % 3 == 0 ? " - " : "*");
+    }
+    exponents += "1";
+    for (unsigned threads : {2U, 3U, 7U})
+    {
+        CHECK(evaluate_parallel(exponents, 4, threads) == evaluate(exponents));
+    }
+
+    std::string nested = std::string(100000, '(') + "1" + std::string(100000, ')') + " / 3";
+    CHECK(evaluate_parallel(nested, 4, 4) == Result{1.0 / 3, false});
+}
+
+TEST_CASE("builder", "[builder]")
+{
+    auto same_program = [](auto const& program, std::string const& input) {
+        auto postfix = infix_to_postfix(tokenize(input));
+
+        return std::equal(program.begin(), program.end(), postfix.begin(), postfix.end());
+    };
+
+    auto e1 = lit(5) + lit(8) / 2;
+    CHECK(same_program(compile(e1), "5 + 8 / 2"));
+    CHECK(evaluate(e1) == evaluate("5 + 8 / 2"));
+
+    auto e2 = (lit(6) + 8) / (lit(5) + 2) * 12;
+    CHECK(same_program(compile(e2), "(6 + 8) / (5 + 2) * 12"));
+    CHECK(evaluate(e2) == Result{24, false});
+
+    auto e3 = 1.0 - lit(2) - 3 - (4 - (5 - lit(0.1)) * 3);
+    CHECK(same_program(compile(e3), "1 - 2 - 3 - (4 - (5 - 0.1) * 3)"));
+    CHECK(evaluate(e3) == evaluate("1 - 2 - 3 - (4 - (5 - 0.1) * 3)"));
+    CHECK(compile(e3).max_depth == 4);
+}
+
+TEST_CASE("FusedProgram", "[fused]")
+{
+    std::vector<std::string> inputs{
+        "(6 + 8) / (5 + 2) * 12",
+        "(6 + 8) / (5 + 2) * 3 +",
+        "1 - (6 + 8) / (5 + 2)",
+        "(5 + 2) * (5 + 2) - 0.1",
+        "(6 + 8) / (5 + 2)"};
+
+    FusedProgram program(inputs);
+    CHECK(program.outputs() == 5);
+    // Constants 6 8 5 2 12 1 0.1, and + + / * - * - over them.
+    CHECK(program.nodes() == 14);
+
+    auto results = program.evaluate();
+    REQUIRE(results.size() == inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+        CHECK(results[i] == evaluate(inputs[i]));
+    }
+}
+
+TEST_CASE("evaluate_batch", "[batch]")
+{
+    std::vector<std::string> inputs{
+        "5 + 8 / 2",
+        "(6 + 8) / (5 + 2) * 3 +",
+        "",
+        "(7 + 8) / 2",
+        "1 + (2",
+        "3",
+        "2 * 2 * 2",
+        "1 - 1",
+        "(6 + 8) 10 / (5 + 2) * 3 +",
+        "4 / 8"};
+
+    std::string data;
+    std::vector<std::size_t> offsets{0};
+    for (auto const& input : inputs)
+    {
+        data += input;
+        offsets.push_back(data.size());
+    }
+
+    std::vector<double> values(inputs.size());
+    std::vector<std::uint8_t> validity(2, 0xff);
+    std::vector<BatchError> errors(inputs.size());
+    evaluate_batch(data.data(), offsets.data(), inputs.size(), values.data(), validity.data(),
+        errors.data());
+
+    CHECK(validity[0] == 0b1110'1001);
+    CHECK(validity[1] == 0b10);
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+        Result expected = evaluate(inputs[i]);
+        bool valid = (validity[i / 8] >> (i % 8) & 1) != 0;
+
+        CHECK(valid == !expected.error);
+        CHECK(errors[i] == (expected.error ? BatchError::syntax : BatchError::none));
+        CHECK(values[i] == expected.result);
+    }
+}
+
+TEST_CASE("container policies", "[policy]")
+{
+    SmallVector<int, 2> small{1, 2, 3};
+    small.pop_back();
+    small.push_back(4);
+    SmallVector<int, 2> small_copy = small;
+    CHECK(small_copy == SmallVector<int, 2>{1, 2, 4});
+
+    RingBuffer<int> ring;
+    for (int i = 0; i < 40; i++)
+    {
+        ring.push_back(i);
+        ring.pop_front();
+        ring.push_back(i);
+    }
+    CHECK(ring.size() == 40);
+    CHECK(ring.front() == 20);
+    CHECK(ring.back() == 39);
+
+    for (std::string input :
+         {"5 + 8 / 2", "(6 + 8) / (5 + 2) * 12", "(6 + 8 / (5 + 2) * 3", "1 + 2)", ""})
+    {
+        Result expected = evaluate(input);
+        CHECK(evaluate_with<small_vector_policy>(input) == expected);
+        CHECK(evaluate_with<ring_buffer_policy>(input) == expected);
+    }
+
+    std::string deep = "0.3";
+    for (int i = 0; i < 100; i++)
+    {
+        deep = "(" + deep + " - 1) / 3";
+    }
+    CHECK(evaluate_with<small_vector_policy>(deep) == evaluate(deep));
+    CHECK(evaluate_with<ring_buffer_policy>(deep) == evaluate(deep));
+}
+
+TEST_CASE("admission limits", "[admission]")
+{
+    Result rejected{0, true, ErrorKind::limit};
+
+    CHECK(evaluate("(6 + 8) / (5 + 2) * 12", Limits{}) == Result{24, false});
+    CHECK(evaluate("(6 + 8) / (5 + 2) * 3 +", Limits{}) == Result{0, true});
+    CHECK_FALSE(rejected == Result{0, true});
+
+    Limits length;
+    length.max_input_length = 9;
+    CHECK(evaluate("5 + 8 / 2", length) == Result{9, false});
+    CHECK(evaluate("5 + 8 / 2 ", length) == rejected);
+
+    Limits tokens;
+    tokens.max_tokens = 5;
+    CHECK(evaluate("1.5e+3 + 2.25 * 10", tokens) == Result{1522.5, false});
+    CHECK(evaluate("(1.5e+3 + 2.25) * 10", tokens) == rejected);
+
+    Limits nesting;
+    nesting.max_nesting = 2;
+    CHECK(evaluate("((1 + 2) * (3 + 4)) + (5)", nesting) == Result{26, false});
+    CHECK(evaluate("((1 + (2)) * 3)", nesting) == rejected);
+
+    Limits operations;
+    operations.max_operations = 2;
+    CHECK(evaluate("(1 - 2) * 3", operations) == Result{-3, false});
+    CHECK(evaluate("1 - 2 * 3 + 4", operations) == rejected);
+
+    // Bytes that only look like part of a number are tokens of their own.
+    Limits small;
+    small.max_tokens = 3;
+    small.max_operations = 1;
+    CHECK(evaluate("1 + 2", small) == Result{3, false});
+    CHECK(evaluate("1" + std::string(100000, '.'), small) == rejected);
+    CHECK(evaluate("1" + std::string(50000, 'e'), small) == rejected);
+    CHECK(evaluate("1e5e5e5e5e5e5", small) == rejected);
+    CHECK(within_limits("1e5", small));
+}
+
+TEST_CASE("compact tokens", "[token]")
+{
+    CHECK(Token(2.5).is_number());
+    CHECK(Token(2.5).number() == 2.5);
+    CHECK(Token(-0.0).is_number());
+    CHECK(std::signbit(Token(-0.0).number()));
+    CHECK(Token(std::numeric_limits<double>::infinity()).is_number());
+    CHECK(Token(-std::numeric_limits<double>::quiet_NaN()).is_number());
+    CHECK(std::isnan(Token(-std::numeric_limits<double>::quiet_NaN()).number()));
+    CHECK_FALSE(Token('+').is_number());
+    CHECK(Token('(').op() == '(');
+
+    std::vector<Token> infix;
+    scan_tokens("(6 + 8) / (5 + 2) * 12", infix);
+    CHECK(
+        infix
+        == std::vector<Token>{
+            '(', 6.0, '+', 8.0, ')', '/', '(', 5.0, '+', 2.0, ')', '*', 12.0});
+
+    std::vector<Token> postfix;
+    std::vector<char> ops;
+    CHECK(infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops) == 3);
+    CHECK(postfix == std::vector<Token>{6.0, 8.0, '+', 5.0, 2.0, '+', '/', 12.0, '*'});
+
+    for (std::string input : {"5 + 8 / 2", "(6 + 8) / (5 + 2) * 3 +", "1 - 0.1 * (3 - 1e-3)"})
+    {
+        CHECK(evaluate_with<compact_policy>(input) == evaluate(input));
+    }
+}
+
+TEST_CASE("strict floating-point errors", "[strict]")
+{
+    CHECK(evaluate("1 / 0").result == std::numeric_limits<double>::infinity());
+    CHECK(evaluate_strict("1 / 0") == Result{0, true, ErrorKind::divide_by_zero});
+    CHECK(evaluate_strict("(0 - 0) / 0") == Result{0, true, ErrorKind::invalid_operation});
+    CHECK(evaluate_strict("1e300 * 1e300 / 1e300") == Result{0, true, ErrorKind::overflow});
+    CHECK(evaluate_strict("(6 + 8) / (5 + 2) * 12") == Result{24, false});
+    CHECK(evaluate_strict("(6 + 8) / (5 + 2) * 3 +") == Result{0, true});
+
+    std::vector<std::string> inputs(150, "1 / 3");
+    inputs[3] = "1 / (2 - 2)";
+    inputs[70] = "1e300 * 1e300";
+    inputs[71] = "1 +";
+    inputs[149] = "0 / 0";
+
+    std::string data;
+    std::vector<std::size_t> offsets{0};
+    for (auto const& input : inputs)
+    {
+        data += input;
+        offsets.push_back(data.size());
+    }
+
+    std::vector<double> values(inputs.size());
+    std::vector<std::uint8_t> validity((inputs.size() + 7) / 8);
+    std::vector<BatchError> errors(inputs.size());
+    evaluate_batch(data.data(), offsets.data(), inputs.size(), values.data(), validity.data(),
+        errors.data(), true);
+
+    for (std::size_t i = 0; i < inputs.size(); i++)
+    {
+        Result expected = evaluate_strict(inputs[i]);
+        bool valid = (validity[i / 8] >> (i % 8) & 1) != 0;
+
+        CHECK(valid == !expected.error);
+        CHECK(values[i] == expected.result);
+    }
+    CHECK(errors[3] == BatchError::divide_by_zero);
+    CHECK(errors[70] == BatchError::overflow);
+    CHECK(errors[71] == BatchError::syntax);
+    CHECK(errors[149] == BatchError::invalid_operation);
+    CHECK(std::count(errors.begin(), errors.end(), BatchError::none) == 146);
+}
+
+TEST_CASE("MemoStore", "[memo]")
+{
+    std::string path = "memo_store_test.bin";
+    std::remove(path.c_str());
+
+    {
+        MemoStore store(path, true, 48);
+        CHECK(evaluate("(6 + 8) / (5 + 2) * 12", store) == Result{24, false});
+        CHECK(evaluate("(6 + 8) / (5 + 2) * 3 +", store) == Result{0, true});
+        CHECK(evaluate("(6+8)/(5+2)*12.0", store) == Result{24, false});
+        CHECK(store.size() == 2);
+
+        CHECK_THROWS_AS(MemoStore(path, true), std::runtime_error);
+
+        // A reader sees entries as soon as they are inserted.
+        MemoStore reader(path, false);
+        CHECK(reader.size() == 2);
+        CHECK(reader.lookup(memo_key({1.0, '/', 3.0})) == std::nullopt);
+        store.insert(memo_key({1.0, '/', 3.0}), Result{0.25, false});
+        CHECK(reader.lookup(memo_key({1.0, '/', 3.0})) == Result{0.25, false});
+
+        for (int i = 0; i < 100; i++)
+        {
+            evaluate(std::to_string(i) + " * 2", store);
+        }
+        CHECK(store.size() == 48);
+        CHECK(store.full());
+        CHECK_FALSE(store.insert(memo_key({1.0, '/', 7.0}), Result{0, false}));
+        CHECK(store.insert(memo_key({1.0, '/', 3.0}), Result{0.25, false}));
+    }
+
+    {
+        MemoStore store(path, false);
+        CHECK_FALSE(store.writable());
+        CHECK(store.size() == 48);
+        CHECK(evaluate("1 / 3", store) == Result{0.25, false});
+        CHECK(evaluate("6 + 8 / 2 + 2 * 12", store) == Result{34, false});
+        CHECK(store.size() == 48);
+    }
+
+    std::remove(path.c_str());
+    CHECK_THROWS_AS(MemoStore(path, false), std::runtime_error);
+
+    {
+        // Threads sharing a writable store, with overlapping expressions.
+        MemoStore store(path, true, 1000);
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&store, &mismatches, t] {
+                for (int i = 0; i < 400; i++)
+                {
+                    int n = (i + t * 100) % 600;
+                    if (!(evaluate(std::to_string(n) + " + 1", store) == Result{n + 1.0, false}))
+                    {
+                        mismatches++;
+                    }
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        CHECK(mismatches == 0);
+        CHECK(store.size() == 600);
+        CHECK_FALSE(store.full());
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Document", "[document]")
+{
+    Document doc("(6 + 8) / (5 + 2) * 12");
+    CHECK(doc.result() == Result{24, false});
+
+    CHECK(doc.edit(1, 1, "13") == evaluate("(13 + 8) / (5 + 2) * 12"));
+    CHECK(doc.edit(0, 0, "(") == Result{0, true});
+    CHECK(doc.edit(doc.text().size(), 0, ")") == evaluate("((13 + 8) / (5 + 2) * 12)"));
+    CHECK(doc.edit(2, 2, "") == evaluate("(( + 8) / (5 + 2) * 12)"));
+    CHECK(doc.edit(2, 0, "4.5") == evaluate("((4.5 + 8) / (5 + 2) * 12)"));
+    CHECK(doc.text() == "((4.5 + 8) / (5 + 2) * 12)");
+    CHECK_THROWS_AS(doc.edit(100, 0, "1"), std::out_of_range);
+
+    // Nesting deeper than the stack could recurse through is built, edited and torn down.
+    {
+        std::size_t depth = 300000;
+        Document deep(std::string(depth, '(') + "1" + std::string(depth, ')'));
+        CHECK(deep.result() == Result{1, false});
+        CHECK(deep.edit(depth, 1, "2.5 * 2") == Result{5, false});
+        CHECK(deep.edit(0, 1, "") == Result{0, true});
+    }
+
+    // Parentheses added and removed around and inside a document of many chunks, at the root
+    // and a few groups down.
+    {
+        std::string body;
+        for (int i = 0; i < 3000; i++)
+        {
+            body += "(" + std::to_string(i % 97) + " + 3.5) * 2 - " + std::to_string(i % 13)
+                + " / 7 + ";
+        }
+        body += "1";
+
+        for (std::string prefix : {"", "2 * (1 + (3 - "})
+        {
+            std::string suffix = prefix.empty() ? "" : ") / 4) * 5)";
+            Document wrapped(prefix + "(" + body + suffix);
+            std::size_t mid = wrapped.text().find(" - ", wrapped.text().size() / 2);
+            std::size_t end = prefix.size() + 1 + body.size();
+
+            auto check = [&wrapped](std::size_t offset, std::size_t removed, char const* text) {
+                Result result = wrapped.edit(offset, removed, text);
+                CHECK(result == evaluate(wrapped.text()));
+            };
+
+            check(end, 0, ")");
+            check(mid, 0, "(");
+            check(mid + 40, 0, ")");
+            check(mid, 1, "");
+            check(mid + 39, 1, "");
+            check(end, 1, "");
+            check(mid, 0, "(");
+            check(mid, 1, "");
+            check(prefix.size(), 1, "");
+            check(prefix.size(), 0, "(");
+            check(end, 0, ")");
+            check(end, 1, "");
+            check(prefix.size(), 0, ") + (");
+            check(prefix.size(), 5, "");
+        }
+    }
+
+    // Random edits, checked against evaluating the whole text.
+    std::mt19937 rng(7);
+    char const* pieces[] = {"1", "23", "0.5", " ", "+", "-", "*", "/", "(", ")", "(2 * 3)", ""};
+    Document random("(1 + 2) * ((3 - 4) / (5 + (6 * 7))) - 8");
+
+    for (int i = 0; i < 2000; i++)
+    {
+        std::size_t offset = rng() % (random.text().size() + 1);
+        std::size_t removed = rng() % 3;
+        Result result = random.edit(offset, removed, pieces[rng() % std::size(pieces)]);
+
+        REQUIRE(result == evaluate(random.text()));
+    }
+
+    // A longer document, edited with pieces that break numbers and parentheses apart. Most
+    // edits that leave it invalid are undone, so it spends time in both states.
+    std::string long_text;
+    for (int i = 0; i < 400; i++)
+    {
+        long_text += std::to_string(i % 17 + 1) + (i % 3 == 0 ? " + (" : " * (")
+            + std::to_string(i % 5 + 2) + (i % 2 == 0 ? " - 1.5) / " : " + 0.25) - ");
+    }
+    long_text += "3";
+
+    char const* breaking[] = {
+        "1", "0.5", " ", "+", "*", "/", "(", ")", "(2 - 7)", "", "e", "e+", "1e", "x", "1e999",
+        "1e-400", "(4 +", "3)"};
+    Document edited(long_text);
+    REQUIRE(edited.result() == evaluate(long_text));
+
+    auto same = [](Result a, Result b) {
+        bool both_nan = std::isnan(a.result) && std::isnan(b.result);
+
+        return a.error == b.error && (a.error || a.result == b.result || both_nan);
+    };
+
+    for (int i = 0; i < 3000; i++)
+    {
+        std::size_t offset = rng() % (edited.text().size() + 1);
+        std::size_t removed = std::min<std::size_t>(rng() % 4, edited.text().size() - offset);
+        std::string old = edited.text().substr(offset, removed);
+        std::string piece = breaking[rng() % std::size(breaking)];
+
+        Result result = edited.edit(offset, removed, piece);
+        REQUIRE(same(result, evaluate(edited.text())));
+
+        if (result.error && rng() % 20 != 0)
+        {
+            result = edited.edit(offset, piece.size(), old);
+            REQUIRE(same(result, evaluate(edited.text())));
+        }
+    }
+}
+
+TEST_CASE("TieredEvaluator", "[tiered]")
+{
+    for (std::string input :
+         {"5 + 8 / 2", "(6 + 8) / (5 + 2) * 12", "1 - 0.1 * (3 - 1e-3) / 7 - 2 * 3 * 4"})
+    {
+        std::vector<symbol> infix;
+        scan_tokens(input, infix);
+        std::vector<symbol> postfix;
+        std::vector<char> ops;
+        std::size_t max_depth = infix_to_postfix_into(infix.begin(), infix.end(), postfix, ops);
+
+        FlatProgram program(postfix, max_depth);
+        CHECK(program.size() < postfix.size());
+        CHECK(Result{program.run(), false} == evaluate(input));
+    }
+
+    TieredEvaluator::Options options;
+    options.promote_after = 10;
+    TieredEvaluator tiered(options);
+
+    std::vector<std::string> inputs{"(6 + 8) / (5 + 2) * 12", "1 / 3 - 0.1", "1 +"};
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    for (int t = 0; t < 4; t++)
+    {
+        // Catch assertions are not thread safe, so threads only count mismatches.
+        threads.emplace_back([&tiered, &inputs, &mismatches] {
+            for (int i = 0; i < 50; i++)
+            {
+                for (auto const& input : inputs)
+                {
+                    if (!(tiered.evaluate(input) == evaluate(input)))
+                    {
+                        mismatches++;
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    CHECK(mismatches == 0);
+
+    tiered.wait_for_promotions();
+    CHECK(tiered.evaluate("1 / 3 - 0.1") == evaluate("1 / 3 - 0.1"));
+
+    auto counters = tiered.counters();
+    CHECK(counters.promotions == 2);
+    CHECK(counters.errors == 200);
+    CHECK(counters.interpreted + counters.compiled == 401);
+    CHECK(counters.interpreted >= 20);
+    CHECK(counters.compiled >= 1);
+    CHECK(counters.evictions == 0);
+
+    // promote_after = 0 compiles on the first evaluation.
+    TieredEvaluator eager(TieredEvaluator::Options{0, 16});
+    CHECK(eager.evaluate("5 + 8 / 2") == Result{9, false});
+    eager.wait_for_promotions();
+    CHECK(eager.evaluate("5 + 8 / 2") == Result{9, false});
+    CHECK(eager.counters().promotions == 1);
+    CHECK(eager.counters().compiled == 1);
+
+    // A bounded evaluator keeps an expression that is in use while one-off ones come and go.
+    TieredEvaluator bounded(TieredEvaluator::Options{10, 4});
+    for (int i = 0; i < 100; i++)
+    {
+        std::string once = std::to_string(i) + " * 3 - 1";
+        CHECK(bounded.evaluate(once) == evaluate(once));
+        CHECK(bounded.evaluate("1 / 3 - 0.1") == evaluate("1 / 3 - 0.1"));
+    }
+
+    bounded.wait_for_promotions();
+    CHECK(bounded.evaluate("1 / 3 - 0.1") == evaluate("1 / 3 - 0.1"));
+
+    auto bounded_counters = bounded.counters();
+    CHECK(bounded_counters.evictions == 97);
+    CHECK(bounded_counters.promotions == 1);
+    CHECK(bounded_counters.compiled >= 1);
+}
+
+TEST_CASE("Script", "[script]")
+{
+    Script script("a = 3 * x; b = a + y\nc = (a - b) / 2;\n d = 1 / 3 - y * a;");
+    CHECK(script.inputs() == std::vector<std::string>{"x", "y"});
+    CHECK(script.names() == std::vector<std::string>{"a", "b", "c", "d"});
+    CHECK(script.levels() == 3);
+
+    auto substituted = [](double x, double y) {
+        std::string a = "(3 * " + std::to_string(x) + ")";
+        std::string b = "(" + a + " + " + std::to_string(y) + ")";
+
+        return std::vector<double>{
+            evaluate(a).result,
+            evaluate(b).result,
+            evaluate("(" + a + " - " + b + ") / 2").result,
+            evaluate("1 / 3 - " + std::to_string(y) + " * " + a).result};
+    };
+
+    CHECK(script.evaluate({2, 0.5}) == substituted(2, 0.5));
+    CHECK_THROWS_AS(script.evaluate({2}), std::invalid_argument);
+
+    std::size_t rows = 1000;
+    std::vector<double> inputs;
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        inputs.push_back(double(row) / 8);
+        inputs.push_back(double(row % 7) + 0.25);
+    }
+
+    std::vector<double> outputs(rows * 4);
+    script.evaluate(inputs.data(), rows, outputs.data(), 4);
+
+    bool all_equal = true;
+    for (std::size_t row = 0; row < rows; row++)
+    {
+        auto expected = substituted(inputs[2 * row], inputs[2 * row + 1]);
+        all_equal = all_equal
+                 && std::equal(expected.begin(), expected.end(), outputs.begin() + 4 * row);
+    }
+    CHECK(all_equal);
+
+    CHECK_THROWS_AS(Script("a = b + 1; b = 2"), InfixError);
+    CHECK_THROWS_AS(Script("a = 1; a = 2"), InfixError);
+    CHECK_THROWS_AS(Script("a = 1 +"), InfixError);
+    CHECK_THROWS_AS(Script("a + 1"), InfixError);
+    CHECK_THROWS_AS(Script("1a = 1"), InfixError);
+    CHECK_THROWS_AS(Script("a = 1e999 * x"), InfixError);
+    CHECK(Script("").names().empty());
+
+    // Names and numbers that cross the scanner's 64 byte blocks, and a name right after an
+    // exponent.
+    std::string long_name(70, 'v');
+    Script spanning("a = " + std::string(58, ' ') + long_name + " * 2e1*x_1 + 1234567.25 - x_1");
+    CHECK(spanning.inputs() == std::vector<std::string>{long_name, "x_1"});
+    CHECK(spanning.evaluate({3, 0.5}) == std::vector<double>{3 * 2e1 * 0.5 + 1234567.25 - 0.5});
+}